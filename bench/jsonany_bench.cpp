@@ -0,0 +1,464 @@
+/**
+ * @author Huahang Liu
+ * @since 2026-10-16
+ */
+
+#include <benchmark/benchmark.h>
+#include <json/any.h>
+#include <json/parallel.h>
+#include <json/patch.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "test_structs.h"
+
+// Every benchmark reports allocs/op, counted by the global operator new.
+static std::atomic<size_t> allocations(0);
+
+void* operator new(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  void* p = std::malloc(size != 0 ? size : 1);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+class AllocationCounter final {
+ public:
+  explicit AllocationCounter(benchmark::State& state)
+      : state(state), start(allocations.load()) {}
+
+  ~AllocationCounter() {
+    state.counters["allocs/op"] =
+        benchmark::Counter(static_cast<double>(allocations.load() - start),
+                           benchmark::Counter::kAvgIterations);
+  }
+
+ private:
+  benchmark::State& state;
+  size_t start;
+};
+
+Singer makeSinger(int i) { return Singer{i % 2 == 0 ? "rapper" : "rocker", i}; }
+
+Band makeBand(int size) {
+  Band band;
+  for (int i = 0; i < size; i++) {
+    band.singers.push_back(makeSinger(i));
+  }
+  return band;
+}
+
+Friend makeFriend(int i) {
+  switch (i % 3) {
+    case 0:
+      return Friend{"friend " + std::to_string(i), makeSinger(i)};
+    case 1:
+      return Friend{"friend " + std::to_string(i), "secret"};
+    default:
+      return Friend{"friend " + std::to_string(i), i};
+  }
+}
+
+Person makePerson(int size) {
+  Person person;
+  json::Parse(person,
+              "{\"name\":\"p1\",\"age\":4,\"address\":{\"country\":\"china\","
+              "\"city\":\"beijing\",\"street\":\"wangjing\",\"neighbors\":[]},"
+              "\"friends\":[],\"secret\":\"the kind!\"}");
+  for (int i = 0; i < size; i++) {
+    person.friends.push_back(makeFriend(i));
+  }
+  return person;
+}
+
+Telemetry makeTelemetry(int size) {
+  Telemetry telemetry;
+  telemetry.id = 42;
+  for (int i = 0; i < size; i++) {
+    telemetry.samples.push_back(i * 0.37);
+    telemetry.offsets.push_back(i * 1000003LL);
+    telemetry.flags.push_back(i % 3 == 0);
+  }
+  return telemetry;
+}
+
+template <typename T>
+T makeFixture(int size);
+
+template <>
+Singer makeFixture<Singer>(int) {
+  return makeSinger(18);
+}
+
+template <>
+Band makeFixture<Band>(int size) {
+  return makeBand(size);
+}
+
+template <>
+Friend makeFixture<Friend>(int) {
+  return makeFriend(0);
+}
+
+template <>
+Person makeFixture<Person>(int size) {
+  return makePerson(size);
+}
+
+template <>
+Telemetry makeFixture<Telemetry>(int size) {
+  return makeTelemetry(size);
+}
+
+template <typename T>
+void BM_Parse(benchmark::State& state) {
+  T fixture = makeFixture<T>(static_cast<int>(state.range(0)));
+  std::string json = json::Dump(fixture);
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    T obj;
+    json::Parse(obj, json);
+    benchmark::DoNotOptimize(obj);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(json.size()));
+}
+
+template <typename T>
+void BM_Dump(benchmark::State& state) {
+  T fixture = makeFixture<T>(static_cast<int>(state.range(0)));
+  size_t bytes = json::Dump(fixture).size();
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    std::string json = json::Dump(fixture);
+    benchmark::DoNotOptimize(json);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(bytes));
+}
+
+template <typename T>
+void BM_DumpPretty(benchmark::State& state) {
+  T fixture = makeFixture<T>(static_cast<int>(state.range(0)));
+  size_t bytes = json::DumpPretty(fixture).size();
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    std::string json = json::DumpPretty(fixture);
+    benchmark::DoNotOptimize(json);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(bytes));
+}
+
+#define JSON_ANY_BENCH_FIXTURE(Type)                               \
+  BENCHMARK_TEMPLATE(BM_Parse, Type)->RangeMultiplier(16)->Range(1, 4096); \
+  BENCHMARK_TEMPLATE(BM_Dump, Type)->RangeMultiplier(16)->Range(1, 4096);  \
+  BENCHMARK_TEMPLATE(BM_DumpPretty, Type)->RangeMultiplier(16)->Range(1, 4096)
+
+JSON_ANY_BENCH_FIXTURE(Band);
+JSON_ANY_BENCH_FIXTURE(Person);
+JSON_ANY_BENCH_FIXTURE(Telemetry);
+BENCHMARK_TEMPLATE(BM_Parse, Singer)->Arg(1);
+BENCHMARK_TEMPLATE(BM_Dump, Singer)->Arg(1);
+BENCHMARK_TEMPLATE(BM_DumpPretty, Singer)->Arg(1);
+BENCHMARK_TEMPLATE(BM_Parse, Friend)->Arg(1);
+BENCHMARK_TEMPLATE(BM_Dump, Friend)->Arg(1);
+BENCHMARK_TEMPLATE(BM_DumpPretty, Friend)->Arg(1);
+
+// Any benchmarks take the holder kind as their argument: 0 holds a value,
+// 1 a shared_ptr.
+json::Any makeAny(int64_t kind, int size) {
+  if (kind == 0) {
+    return json::Any(makeBand(size));
+  }
+  return json::Any(std::make_shared<Band>(makeBand(size)));
+}
+
+void BM_AnyCopy(benchmark::State& state) {
+  json::Any any = makeAny(state.range(0), 16);
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    json::Any copy(any);
+    benchmark::DoNotOptimize(copy);
+  }
+}
+BENCHMARK(BM_AnyCopy)->Arg(0)->Arg(1);
+
+void BM_AnyAssign(benchmark::State& state) {
+  json::Any any = makeAny(state.range(0), 16);
+  json::Any target;
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    target = any;
+    benchmark::DoNotOptimize(target);
+  }
+}
+BENCHMARK(BM_AnyAssign)->Arg(0)->Arg(1);
+
+void BM_AnyCast(benchmark::State& state) {
+  json::Any any = makeAny(state.range(0), 16);
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    Band band;
+    any.Cast(band);
+    benchmark::DoNotOptimize(band);
+  }
+}
+BENCHMARK(BM_AnyCast)->Arg(0)->Arg(1);
+
+void BM_AnyCastFromJson(benchmark::State& state) {
+  Band band = makeBand(16);
+  std::string json = json::Dump(band);
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    json::Any any;
+    json::Parse(any, json);
+    benchmark::DoNotOptimize(json::AnyCast<Band>(any));
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(json.size()));
+}
+BENCHMARK(BM_AnyCastFromJson);
+
+void BM_AnyCastFunction(benchmark::State& state) {
+  json::Any any = makeAny(state.range(0), 16);
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(json::AnyCast<Band>(any));
+  }
+}
+BENCHMARK(BM_AnyCastFunction)->Arg(0)->Arg(1);
+
+// Repeated Dump of an unchanged value; the argument turns on CacheEncoded.
+void BM_AnyDumpRepeated(benchmark::State& state) {
+  json::Any any = makeAny(1, 256);
+  if (state.range(0) != 0) {
+    any.CacheEncoded();
+  }
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(json::Dump(any));
+  }
+}
+BENCHMARK(BM_AnyDumpRepeated)->Arg(0)->Arg(1);
+
+// Dump of one shared Band from several threads at once; the argument picks
+// a FrozenAny snapshot, which splices its text, over the live Any.
+void BM_AnyDumpShared(benchmark::State& state) {
+  static const json::Any any = makeAny(1, 256);
+  static const json::FrozenAny frozen = any.Freeze();
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    if (state.range(0) != 0) {
+      benchmark::DoNotOptimize(json::Dump(frozen));
+    } else {
+      benchmark::DoNotOptimize(json::Dump(any));
+    }
+  }
+}
+BENCHMARK(BM_AnyDumpShared)->Arg(0)->Arg(1)->Threads(1)->Threads(4);
+
+// Parse of a Telemetry whose last sample is a string, so it is rejected
+// after reading the whole record. The argument picks json::TryParse over
+// the throwing json::Parse.
+void BM_ParseRejected(benchmark::State& state) {
+  Telemetry fixture = makeTelemetry(64);
+  std::string json = json::Dump(fixture);
+  json.insert(json.find("],\"offsets\""), ",\"x\"");
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    Telemetry obj;
+    if (state.range(0) != 0) {
+      benchmark::DoNotOptimize(json::TryParse(obj, json));
+    } else {
+      try {
+        json::Parse(obj, json);
+      } catch (const std::invalid_argument& e) {
+        benchmark::DoNotOptimize(e);
+      }
+    }
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(json.size()));
+}
+BENCHMARK(BM_ParseRejected)->Arg(0)->Arg(1);
+
+// Parse of a Setlist with 1024 venues, in full or projected onto the
+// members around them; the argument turns on the projection.
+void BM_ParseProjected(benchmark::State& state) {
+  Setlist fixture;
+  fixture.name = "tour";
+  fixture.year = 2020;
+  for (int i = 0; i < 1024; i++) {
+    fixture.venues.push_back(Venue{"venue " + std::to_string(i), i});
+  }
+  std::string json = json::Dump(fixture);
+  json::Projection projection({"/name", "/year"});
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    Setlist obj;
+    if (state.range(0) != 0) {
+      json::Parse(obj, json, projection);
+    } else {
+      json::Parse(obj, json);
+    }
+    benchmark::DoNotOptimize(obj);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(json.size()));
+}
+BENCHMARK(BM_ParseProjected)->Arg(0)->Arg(1);
+
+// Parse of 4096 venues sharing 8 names longer than the small string
+// buffer; the argument binds the names as json::InternedString.
+template <typename T>
+std::vector<T> parseVenues(const std::string& json) {
+  json::SaxReader reader(json.data(), json.size());
+  return json::ParseArray<T>(reader);
+}
+
+void BM_ParseInterned(benchmark::State& state) {
+  std::vector<Venue> fixture;
+  for (int i = 0; i < 4096; i++) {
+    fixture.push_back(Venue{"stadium number " + std::to_string(i % 8), i});
+  }
+  std::string json = json::Dump(fixture);
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    if (state.range(0) != 0) {
+      benchmark::DoNotOptimize(parseVenues<SharedVenue>(json));
+    } else {
+      benchmark::DoNotOptimize(parseVenues<Venue>(json));
+    }
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(json.size()));
+}
+BENCHMARK(BM_ParseInterned)->Arg(0)->Arg(1);
+
+// Sync of a Setlist with 1024 venues after one venue changed, as a JSON
+// Patch or as a full Dump; the argument picks json::Diff.
+void BM_Diff(benchmark::State& state) {
+  Setlist before;
+  before.name = "tour";
+  before.year = 2020;
+  for (int i = 0; i < 1024; i++) {
+    before.venues.push_back(Venue{"venue " + std::to_string(i), i});
+  }
+  Setlist after = before;
+  after.venues[512].capacity++;
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    if (state.range(0) != 0) {
+      json::Patch patch = json::Diff(before, after);
+      benchmark::DoNotOptimize(json::Dump(patch));
+    } else {
+      benchmark::DoNotOptimize(json::Dump(after));
+    }
+  }
+}
+BENCHMARK(BM_Diff)->Arg(0)->Arg(1);
+
+// Reparse of a Setlist with 1024 venues every iteration; the argument
+// binds into one long-lived Setlist through a reader that is Reset for each
+// message, instead of a fresh Setlist and reader.
+void BM_ParseInto(benchmark::State& state) {
+  Setlist fixture;
+  fixture.name = "tour";
+  fixture.year = 2020;
+  for (int i = 0; i < 1024; i++) {
+    fixture.venues.push_back(Venue{"stadium number " + std::to_string(i), i});
+  }
+  std::string json = json::Dump(fixture);
+  Setlist obj;
+  json::SaxReader reader(json.data(), json.size());
+  json::ParseInto(obj, reader);
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    if (state.range(0) != 0) {
+      reader.Reset(json.data(), json.size());
+      json::ParseInto(obj, reader);
+      benchmark::DoNotOptimize(obj);
+    } else {
+      Setlist fresh;
+      json::Parse(fresh, json);
+      benchmark::DoNotOptimize(fresh);
+    }
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(json.size()));
+}
+BENCHMARK(BM_ParseInto)->Arg(0)->Arg(1);
+
+// ParseArray over a fixed array of friends; the argument is the thread
+// count, 0 meaning the serial overload.
+void BM_ParseArray(benchmark::State& state) {
+  std::vector<Friend> friends;
+  for (int i = 0; i < 20000; i++) {
+    friends.push_back(makeFriend(i));
+  }
+  std::string json = json::Dump(friends);
+  size_t threads = static_cast<size_t>(state.range(0));
+  std::unique_ptr<json::ThreadPool> pool;
+  if (threads != 0) {
+    pool.reset(new json::ThreadPool(threads));
+  }
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    if (pool) {
+      benchmark::DoNotOptimize(json::ParseArray<Friend>(json, *pool));
+    } else {
+      json::SaxReader reader(json.data(), json.size());
+      benchmark::DoNotOptimize(json::ParseArray<Friend>(reader));
+    }
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(json.size()));
+}
+BENCHMARK(BM_ParseArray)->Arg(0)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+// Dump of the same array into a DOM; the argument is the thread count, 0
+// meaning the serial overload. Threaded runs build the array in place.
+void BM_DumpArray(benchmark::State& state) {
+  std::vector<Friend> friends;
+  for (int i = 0; i < 20000; i++) {
+    friends.push_back(makeFriend(i));
+  }
+  size_t threads = static_cast<size_t>(state.range(0));
+  std::unique_ptr<json::ThreadPool> pool;
+  if (threads != 0) {
+    pool.reset(new json::ThreadPool(threads));
+  }
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    rapidjson::Document doc;
+    if (pool) {
+      std::vector<std::shared_ptr<json::Arena>> arenas;
+      for (size_t i = 0; i < threads * 4; i++) {
+        arenas.push_back(std::make_shared<json::Arena>());
+      }
+      json::Dump(doc, doc.GetAllocator(), arenas, friends, *pool);
+    } else {
+      json::Dump(doc, doc.GetAllocator(), friends);
+    }
+    benchmark::DoNotOptimize(doc);
+  }
+}
+BENCHMARK(BM_DumpArray)->Arg(0)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -12,23 +12,65 @@
 #define RAPIDJSON_HAS_STDSTRING 1
 #endif  // RAPIDJSON_HAS_STDSTRING
 
+#ifndef JSON_ANY_RTTI
+#if defined(__GXX_RTTI) || defined(_CPPRTTI) || defined(__cpp_rtti)
+#define JSON_ANY_RTTI 1
+#else
+#define JSON_ANY_RTTI 0
+#endif
+#endif  // JSON_ANY_RTTI
+
+#ifndef JSON_ANY_HAS_MMAP
+#if defined(__unix__) || defined(__APPLE__)
+#define JSON_ANY_HAS_MMAP 1
+#else
+#define JSON_ANY_HAS_MMAP 0
+#endif
+#endif  // JSON_ANY_HAS_MMAP
+
+#include <json/stats.h>
 #include <rapidjson/document.h>
+#include <rapidjson/error/en.h>
+#include <rapidjson/memorystream.h>
 #include <rapidjson/prettywriter.h>
 #include <rapidjson/rapidjson.h>
+#include <rapidjson/reader.h>
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
 #include <stdint.h>
+#include <string.h>
+#if JSON_ANY_HAS_MMAP
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif  // JSON_ANY_HAS_MMAP
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <initializer_list>
 #include <iostream>
+#include <iterator>
 #include <memory>
+#include <new>
+#include <shared_mutex>
 #include <stdexcept>
 #include <string>
+#include <system_error>
 #include <type_traits>
 #include <typeinfo>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace json {
+inline namespace JSON_ANY_ABI {
 
 template <typename T>
 std::string Dump(T& obj);
@@ -36,277 +78,2674 @@ std::string Dump(T& obj);
 template <typename T>
 void Parse(T& obj, const std::string& json);
 
-class Any final {
+// Memory pool that json::Any values live in. One arena can be shared by
+// every Any bound from the same request and is freed with the last of them.
+using Arena = rapidjson::Document::AllocatorType;
+
+template <typename Writer, typename T>
+void Write(Writer& w, T& obj);
+
+template <typename Writer>
+void Write(Writer& w, std::string& obj);
+
+template <typename Writer, typename T>
+void Write(Writer& w, std::vector<T>& v);
+
+// Selects the SaxReader constructor that parses a mutable buffer in place.
+struct InsituTag {};
+
+// Selects the SaxReader constructor that records errors in a Status instead
+// of throwing them.
+struct NoThrowTag {};
+
+enum class ErrorCode {
+  kOk,
+  kSyntax,         // malformed JSON text
+  kTypeMismatch,   // a value of the wrong JSON type
+  kMissingMember,  // a required member is absent
+};
+
+// Outcome of a non-throwing parse.
+struct Status {
+  ErrorCode code = ErrorCode::kOk;
+  size_t offset = 0;    // where in the source text, for streaming parses
+  std::string path;     // JSON Pointer to the value, e.g. "/friends/2/age"
+  std::string message;  // what a throwing parse would have thrown
+
+  bool Ok() const { return code == ErrorCode::kOk; }
+  explicit operator bool() const { return Ok(); }
+
+  [[noreturn]] void Throw() const { throw std::invalid_argument(message); }
+};
+
+namespace detail {
+
+// Records the first error only; values enclosing the failed one add their
+// path segments as the failure unwinds.
+inline bool Fail(Status& status, ErrorCode code, std::string message,
+                 size_t offset = 0) {
+  if (status.Ok()) {
+    status.code = code;
+    status.offset = offset;
+    status.message = std::move(message);
+  }
+  return false;
+}
+
+inline void PrefixPath(Status& status, const char* name, size_t length) {
+  std::string path;
+  path.reserve(length + 1 + status.path.size());
+  path += '/';
+  path.append(name, length);
+  path += status.path;
+  status.path.swap(path);
+}
+
+inline void PrefixPath(Status& status, size_t index) {
+  std::string name = std::to_string(index);
+  PrefixPath(status, name.data(), name.size());
+}
+
+// FNV-1a over a key, usable in case labels so JSON_ANY_FIELDS can switch
+// on member names. Colliding names become duplicate labels at compile time.
+constexpr uint32_t HashKey(const char* s, size_t length) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < length; i++) {
+    h = (h ^ static_cast<uint8_t>(s[i])) * 16777619u;
+  }
+  return h;
+}
+
+// rapidjson input stream over a mutable buffer of known length, for in-situ
+// parsing. Decoded strings are written back into the buffer, so the parser
+// never copies them. Unlike rapidjson::InsituStringStream the buffer does not
+// need a terminating NUL.
+class InsituMemoryStream final {
  public:
-  Any() : holder(nullptr) { jsonValue.SetNull(); }
+  typedef char Ch;
 
-  Any(const Any& any) : Any() {
-    if (any.holder != nullptr) {
-      holder = any.holder->Clone();
-      jsonValue.SetNull();
-      return;
+  InsituMemoryStream(char* json, size_t length)
+      : src(json), dst(nullptr), begin(json), end(json + length) {}
+
+  Ch Peek() const { return src == end ? '\0' : *src; }
+  Ch Take() { return src == end ? '\0' : *src++; }
+  size_t Tell() const { return static_cast<size_t>(src - begin); }
+
+  Ch* PutBegin() { return dst = src; }
+  void Put(Ch c) { *dst++ = c; }
+  void Flush() {}
+  size_t PutEnd(Ch* b) { return static_cast<size_t>(dst - b); }
+
+ private:
+  char* src;
+  char* dst;
+  char* begin;
+  char* end;
+};
+
+// JSON scalars that are bound and written directly, without Dump and Parse
+// methods of their own.
+template <typename T>
+struct Primitive : std::false_type {};
+
+template <>
+struct Primitive<bool> : std::true_type {
+  static bool Is(const rapidjson::Value& v) { return v.IsBool(); }
+  static bool Get(const rapidjson::Value& v) { return v.GetBool(); }
+  static void Set(rapidjson::Value& v, bool b) { v.SetBool(b); }
+  template <typename Writer>
+  static void Write(Writer& w, bool b) {
+    w.Bool(b);
+  }
+};
+
+template <>
+struct Primitive<int> : std::true_type {
+  static bool Is(const rapidjson::Value& v) { return v.IsInt(); }
+  static int Get(const rapidjson::Value& v) { return v.GetInt(); }
+  static void Set(rapidjson::Value& v, int i) { v.SetInt(i); }
+  template <typename Writer>
+  static void Write(Writer& w, int i) {
+    w.Int(i);
+  }
+};
+
+template <>
+struct Primitive<int64_t> : std::true_type {
+  static bool Is(const rapidjson::Value& v) { return v.IsInt64(); }
+  static int64_t Get(const rapidjson::Value& v) { return v.GetInt64(); }
+  static void Set(rapidjson::Value& v, int64_t i) { v.SetInt64(i); }
+  template <typename Writer>
+  static void Write(Writer& w, int64_t i) {
+    w.Int64(i);
+  }
+};
+
+template <>
+struct Primitive<uint64_t> : std::true_type {
+  static bool Is(const rapidjson::Value& v) { return v.IsUint64(); }
+  static uint64_t Get(const rapidjson::Value& v) { return v.GetUint64(); }
+  static void Set(rapidjson::Value& v, uint64_t u) { v.SetUint64(u); }
+  template <typename Writer>
+  static void Write(Writer& w, uint64_t u) {
+    w.Uint64(u);
+  }
+};
+
+// Integers in the JSON are accepted as doubles too. JSON has no NaN or
+// infinity, so dumping or writing one throws instead of dropping it.
+template <>
+struct Primitive<double> : std::true_type {
+  static bool Is(const rapidjson::Value& v) { return v.IsNumber(); }
+  static double Get(const rapidjson::Value& v) { return v.GetDouble(); }
+  static void Set(rapidjson::Value& v, double d) {
+    if (!std::isfinite(d)) {
+      throwNonFinite();
+    }
+    v.SetDouble(d);
+  }
+  template <typename Writer>
+  static void Write(Writer& w, double d) {
+    if (!w.Double(d)) {
+      throwNonFinite();
     }
-    holder = nullptr;
-    this->jsonValue.CopyFrom(any.jsonValue, this->jsonDoc.GetAllocator());
   }
+  [[noreturn]] static void throwNonFinite() {
+    throw std::invalid_argument("Invalid double: NaN or infinity in JSON");
+  }
+};
 
-  template <typename T>
-  Any(const std::shared_ptr<T> p) : holder(new SharedPointerHolder<T>(p)) {
-    jsonValue.SetNull();
+}  // namespace detail
+
+// Deduplicated copies of strings, for values that repeat across records
+// such as country or city names. Strings are kept until the pool goes away,
+// so every InternedString from a pool must not outlive it. Safe to use from
+// many threads.
+class StringPool final {
+ public:
+  StringPool() {}
+
+  StringPool(const StringPool&) = delete;
+  StringPool& operator=(const StringPool&) = delete;
+
+  // The pooled copy of s, added the first time it is seen.
+  const std::string& Intern(const char* s, size_t length) {
+    Key key{s, length};
+    {
+      std::shared_lock<std::shared_timed_mutex> lock(mutex);
+      auto it = index.find(key);
+      if (it != index.end()) {
+        return *it->second;
+      }
+    }
+    std::lock_guard<std::shared_timed_mutex> lock(mutex);
+    auto it = index.find(key);
+    if (it != index.end()) {
+      return *it->second;
+    }
+    strings.emplace_back(s, length);
+    const std::string& copy = strings.back();
+    index.emplace(Key{copy.data(), copy.size()}, &copy);
+    return copy;
   }
 
-  template <typename T>
-  Any(const T& v) : holder(new ValueHolder<T>(v)) {
-    jsonValue.SetNull();
+  size_t Size() const {
+    std::shared_lock<std::shared_timed_mutex> lock(mutex);
+    return strings.size();
   }
 
-  Any(const char* s) : Any(std::string(s)) {}
+  // Pool that parsed InternedString values go into unless a SaxReader or
+  // StringPoolScope names another. Never destroyed, so its strings stay
+  // valid during static destruction, and never trimmed either: it keeps
+  // every distinct value it is handed for the life of the process. Values
+  // from an open-ended set, like user names, belong in a pool of their own.
+  static StringPool& Global() {
+    static StringPool* pool = new StringPool();
+    return *pool;
+  }
 
-  Any& operator=(const Any& any) {
-    if (any.holder != nullptr) {
-      holder = any.holder->Clone();
-      jsonValue.SetNull();
-      return *this;
+ private:
+  struct Key {
+    const char* s;
+    size_t length;
+    bool operator==(const Key& key) const {
+      return length == key.length && memcmp(s, key.s, length) == 0;
     }
-    holder = nullptr;
-    this->jsonValue.CopyFrom(any.jsonValue, this->jsonDoc.GetAllocator());
-    return *this;
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key& key) const {
+      return detail::HashKey(key.s, key.length);
+    }
+  };
+
+  mutable std::shared_timed_mutex mutex;
+  std::deque<std::string> strings;
+  std::unordered_map<Key, const std::string*, KeyHash> index;
+};
+
+namespace detail {
+
+// Pool that InternedString values bound on this thread go into, or null for
+// the global one. Like BindingInPlace it follows the bind through
+// hand-written Parse methods.
+inline StringPool*& BindingPool() {
+  static thread_local StringPool* pool = nullptr;
+  return pool;
+}
+
+inline StringPool& CurrentPool() {
+  StringPool* pool = BindingPool();
+  return pool != nullptr ? *pool : StringPool::Global();
+}
+
+}  // namespace detail
+
+// Sends the InternedString values bound on this thread to pool until the
+// end of the scope, from a DOM, a cast or a SaxReader without a pool of
+// its own.
+class StringPoolScope final {
+ public:
+  explicit StringPoolScope(StringPool& pool) : saved(detail::BindingPool()) {
+    detail::BindingPool() = &pool;
   }
+  ~StringPoolScope() { detail::BindingPool() = saved; }
 
-  template <typename T>
-  Any& operator=(const T& o) {
-    holder = new ValueHolder<T>(o);
-    jsonValue.SetNull();
-    return *this;
+  StringPoolScope(const StringPoolScope&) = delete;
+  StringPoolScope& operator=(const StringPoolScope&) = delete;
+
+ private:
+  StringPool* saved;
+};
+
+// Immutable string one pointer wide, bound and written like std::string.
+// Equal values from one pool share its copy, so binding a value seen before
+// allocates nothing and comparing is a pointer compare. Dumping to a DOM
+// references the pooled text instead of copying it.
+class InternedString final {
+ public:
+  InternedString() : s(&empty()) {}
+
+  InternedString(const char* s, size_t length,
+                 StringPool& pool = StringPool::Global())
+      : s(&pool.Intern(s, length)) {}
+
+  InternedString(const std::string& s, StringPool& pool = StringPool::Global())
+      : InternedString(s.data(), s.size(), pool) {}
+
+  InternedString(const char* s) : InternedString(s, strlen(s)) {}
+
+  const std::string& Str() const { return *s; }
+  operator const std::string&() const { return *s; }
+
+  bool operator==(const InternedString& other) const {
+    return s == other.s || *s == *other.s;
+  }
+  bool operator!=(const InternedString& other) const {
+    return !(*this == other);
   }
 
-  template <typename T>
-  Any& operator=(const std::shared_ptr<T> p) {
-    holder = new SharedPointerHolder<T>(p);
-    jsonValue.SetNull();
-    return *this;
+ private:
+  static const std::string& empty() {
+    static const std::string* s = new std::string();
+    return *s;
   }
 
-  const std::type_info& TypeInfo() const {
-    return holder != nullptr ? holder->TypeInfo() : typeid(void);
+  const std::string* s;
+};
+
+namespace detail {
+
+template <>
+struct Primitive<InternedString> : std::true_type {
+  static bool Is(const rapidjson::Value& v) { return v.IsString(); }
+  static InternedString Get(const rapidjson::Value& v) {
+    return InternedString(v.GetString(), v.GetStringLength(), CurrentPool());
+  }
+  static void Set(rapidjson::Value& v, const InternedString& s) {
+    v.SetString(rapidjson::StringRef(
+        s.Str().data(), static_cast<rapidjson::SizeType>(s.Str().size())));
   }
+  template <typename Writer>
+  static void Write(Writer& w, const InternedString& s) {
+    w.String(s.Str().data(), static_cast<rapidjson::SizeType>(s.Str().size()));
+  }
+};
 
-  template <typename T>
-  void Cast(T& t) {
-    jsonToHolder<T>();
-    if (holder == nullptr) {
-      throw std::bad_cast();
+}  // namespace detail
+
+// Set of JSON Pointers naming the parts of a document to bind, e.g.
+// {"/name", "/address/city"}. A pointer selects the whole value it names.
+// Under an array, an index selects one element and "-" every element, so
+// "/friends/-/relation" selects the relation of each friend. Elements that
+// are not selected keep their place but have none of their members bound.
+// "" selects the whole document.
+class Projection final {
+ public:
+  enum : uint32_t { kNone = 0xffffffffu, kAll = 0xfffffffeu };
+
+  Projection(std::initializer_list<std::string> pointers) {
+    init(pointers.begin(), pointers.end());
+  }
+
+  explicit Projection(const std::vector<std::string>& pointers) {
+    init(pointers.begin(), pointers.end());
+  }
+
+  static uint32_t Root() { return 0; }
+
+  // The node of member key under node, or kNone when it is not selected.
+  // index is set to the member's position among the selected members.
+  uint32_t Child(uint32_t node, const char* key, size_t length,
+                 size_t& index) const {
+    if (node == kAll || node == kNone) {
+      return node;
     }
-    const auto& holderType = TypeInfo();
-    const auto& valueType = typeid(T);
-    if (holderType != valueType) {
-      throw std::bad_cast();
+    const Node& n = nodes[node];
+    if (n.all) {
+      return kAll;
     }
-    holder->CopyOut(&t);
+    for (index = 0; index < n.children.size(); index++) {
+      const std::string& name = nodes[n.children[index]].name;
+      if (name.size() == length && memcmp(name.data(), key, length) == 0) {
+        return n.children[index];
+      }
+    }
+    return kNone;
   }
 
-  template <typename AllocatorType>
-  void Dump(rapidjson::Value& v, AllocatorType& alloc) {
-    if (jsonValue.IsNull() && holder != nullptr) {
-      holder->Dump(*this);
+  // The node of element index of the array at node, or kNone when it is not
+  // selected.
+  uint32_t Element(uint32_t node, uint64_t index) const {
+    if (node == kAll || node == kNone) {
+      return node;
+    }
+    const Node& n = nodes[node];
+    if (n.all) {
+      return kAll;
     }
-    v.CopyFrom(this->jsonValue, alloc);
+    uint32_t wildcard = kNone;
+    for (uint32_t c : n.children) {
+      if (nodes[c].index == index) {
+        return c;
+      }
+      if (nodes[c].name == "-") {
+        wildcard = c;
+      }
+    }
+    return wildcard;
   }
 
-  void Parse(const rapidjson::Value& v) {
-    jsonValue.CopyFrom(v, jsonDoc.GetAllocator());
-    holder = nullptr;
+  // Bits of every selected member of node, or 0 when there is no fixed
+  // set to wait for.
+  uint64_t Members(uint32_t node) const {
+    if (node == kAll || node == kNone || nodes[node].all ||
+        nodes[node].children.size() > 64) {
+      return 0;
+    }
+    size_t n = nodes[node].children.size();
+    return n == 64 ? ~uint64_t(0) : (uint64_t(1) << n) - 1;
   }
 
  private:
-  template <typename T>
-  bool jsonToHolder() {
-    bool result = false;
-    if (holder == nullptr && (!jsonValue.IsNull())) {
-      try {
-        holder = new SharedPointerHolder<T>();
-        dynamic_cast<SharedPointerHolder<T>*>(holder)->value->Parse(
-            this->jsonValue  //
-        );
-      } catch (const std::invalid_argument&) {
-        holder = nullptr;
-        result = false;
-        return result;
+  enum : uint64_t { kNoIndex = ~uint64_t(0) };
+
+  struct Node {
+    std::string name;
+    uint64_t index = kNoIndex;
+    std::vector<uint32_t> children;
+    bool all = false;
+  };
+
+  template <typename Iterator>
+  void init(Iterator begin, Iterator end) {
+    nodes.emplace_back();
+    for (; begin != end; ++begin) {
+      add(*begin);
+    }
+    spread(Root());
+  }
+
+  void add(const std::string& pointer) {
+    if (!pointer.empty() && pointer[0] != '/') {
+      throw std::invalid_argument("Invalid JSON Pointer: " + pointer);
+    }
+    uint32_t node = 0;
+    size_t pos = 0;
+    while (pos < pointer.size() && !nodes[node].all) {
+      size_t next = pointer.find('/', pos + 1);
+      if (next == std::string::npos) {
+        next = pointer.size();
       }
-      result = true;
+      node = child(node, unescape(pointer.substr(pos + 1, next - pos - 1)));
+      pos = next;
     }
-    return result;
+    nodes[node].all = true;
+    nodes[node].children.clear();
   }
 
- private:
-  class HolderInterface {
-   public:
-    virtual HolderInterface* Clone() const = 0;
-    virtual const std::type_info& TypeInfo() const = 0;
-    virtual const std::type_info& HolderTypeInfo() const = 0;
-    virtual void Dump(Any& any) = 0;
-    virtual void CopyOut(void*) = 0;
-    virtual ~HolderInterface() {}
-  };
+  uint32_t child(uint32_t node, const std::string& name) {
+    for (uint32_t c : nodes[node].children) {
+      if (nodes[c].name == name) {
+        return c;
+      }
+    }
+    uint32_t c = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+    nodes[c].name = name;
+    nodes[c].index = indexOf(name);
+    nodes[node].children.push_back(c);
+    return c;
+  }
 
-  template <typename ValueType>
-  class ValueHolder : public HolderInterface {
-   public:
-    // ValueType is copy constructible
-    ValueHolder(                                           //
-        const typename std::enable_if<                     //
-            std::is_copy_constructible<ValueType>::value,  //
-            ValueType>::type& v)
-        : value(v) {}
-    virtual HolderInterface* Clone() const { return new ValueHolder(value); };
-    virtual const std::type_info& TypeInfo() const { return typeid(ValueType); }
-    virtual const std::type_info& HolderTypeInfo() const {
-      return typeid(ValueHolder<ValueType>);
+  // An element picked by index also gets what "-" selects of every element.
+  void spread(uint32_t node) {
+    uint32_t wildcard = kNone;
+    for (uint32_t c : nodes[node].children) {
+      if (nodes[c].name == "-") {
+        wildcard = c;
+      }
     }
-    virtual void Dump(Any& any) {
-      value.Dump(any.jsonValue, any.jsonDoc.GetAllocator());
+    for (size_t i = 0; i < nodes[node].children.size(); i++) {
+      uint32_t c = nodes[node].children[i];
+      if (wildcard != kNone && nodes[c].index != kNoIndex) {
+        merge(wildcard, c);
+      }
+      spread(c);
     }
-    virtual void CopyOut(void* v) { *reinterpret_cast<ValueType*>(v) = value; }
-    ValueType value;
-  };
+  }
 
-  template <typename ValueType>
-  class SharedPointerHolder : public HolderInterface {
-   public:
-    // ValueType must be default constructible
-    SharedPointerHolder() : value(new ValueType()) {}
-    // ValueType is wrapped inside a shared pointer
-    SharedPointerHolder(const std::shared_ptr<ValueType>& v) : value(v) {}
-    virtual HolderInterface* Clone() const {
-      return new SharedPointerHolder(value);
-    };
-    virtual const std::type_info& TypeInfo() const { return typeid(ValueType); }
-    virtual const std::type_info& HolderTypeInfo() const {
-      return typeid(SharedPointerHolder<ValueType>);
+  void merge(uint32_t from, uint32_t to) {
+    if (nodes[to].all) {
+      return;
     }
-    virtual void Dump(Any& any) {
-      value->Dump(any.jsonValue, any.jsonDoc.GetAllocator());
+    if (nodes[from].all) {
+      nodes[to].all = true;
+      nodes[to].children.clear();
+      return;
     }
-    virtual void CopyOut(void* v) {
-      auto jsonString = json::Dump<ValueType>(*value);
-      json::Parse(*reinterpret_cast<ValueType*>(v), jsonString);
+    for (size_t i = 0; i < nodes[from].children.size(); i++) {
+      uint32_t c = nodes[from].children[i];
+      // child() may grow nodes, so the name is copied out first.
+      std::string name = nodes[c].name;
+      merge(c, child(to, name));
     }
-    std::shared_ptr<ValueType> value;
-  };
+  }
 
-  HolderInterface* holder;
+  // The array index a segment names: digits without a leading zero.
+  static uint64_t indexOf(const std::string& segment) {
+    if (segment.empty() || segment.size() > 19 ||
+        (segment[0] == '0' && segment.size() > 1)) {
+      return kNoIndex;
+    }
+    uint64_t index = 0;
+    for (char c : segment) {
+      if (c < '0' || c > '9') {
+        return kNoIndex;
+      }
+      index = index * 10 + static_cast<uint64_t>(c - '0');
+    }
+    return index;
+  }
 
- private:
-  rapidjson::Document jsonDoc;
-  rapidjson::Value jsonValue;
+  // Reverses the ~1 and ~0 escapes of a pointer segment.
+  static std::string unescape(const std::string& segment) {
+    std::string ret;
+    for (size_t i = 0; i < segment.size(); i++) {
+      if (segment[i] == '~' && i + 1 < segment.size() &&
+          (segment[i + 1] == '0' || segment[i + 1] == '1')) {
+        ret += segment[++i] == '0' ? '~' : '/';
+      } else {
+        ret += segment[i];
+      }
+    }
+    return ret;
+  }
+
+  std::vector<Node> nodes;
 };
 
-template <>
-void Any::SharedPointerHolder<std::string>::Dump(Any& any) {
-  any.jsonValue.SetString(*this->value, any.jsonDoc.GetAllocator());
-}
+// Pull-style token reader on top of rapidjson's iterative SAX parser. Types
+// providing `void Parse(json::SaxReader&)` are bound straight from the token
+// stream, without building a rapidjson::Document first. Every value a Parse
+// method is handed must be consumed, either by reading it or by Skip().
+//
+// A reader built with NoThrowTag never throws. The first error is kept in
+// GetStatus() and ends the token stream, so every loop over it stops; types
+// can take part by providing `bool TryParse(json::SaxReader&)`.
+class SaxReader final {
+ public:
+  SaxReader(const char* json, size_t length,
+            std::shared_ptr<Arena> arena = nullptr)
+      : SaxReader(json, length, std::move(arena), true) {}
 
-template <>
-void Any::SharedPointerHolder<int>::Dump(Any& any) {
-  any.jsonValue.SetInt(*this->value);
-}
+  SaxReader(NoThrowTag, const char* json, size_t length,
+            std::shared_ptr<Arena> arena = nullptr)
+      : SaxReader(json, length, std::move(arena), false) {}
 
-template <>
-void Any::ValueHolder<std::string>::Dump(Any& any) {
-  any.jsonValue.SetString(this->value, any.jsonDoc.GetAllocator());
-}
+  // Parses json in place. Strings handed out point into the buffer, which
+  // is overwritten and must outlive the reader.
+  SaxReader(InsituTag, char* json, size_t length,
+            std::shared_ptr<Arena> arena = nullptr)
+      : arena(std::move(arena)),
+        source(json),
+        stream(json, 0),
+        insituStream(json, length),
+        insitu(true),
+        handler(this),
+        token(kEndToken),
+        tokenOffset(0),
+        stringValue(nullptr),
+        stringLength(0),
+        lazy(false),
+        throwing(true),
+        projection(nullptr),
+        valueNode(Projection::kNone),
+        stopped(false),
+        stringPool(nullptr) {
+    JSON_ANY_STATS_ADD(bytesParsed, length);
+    reader.IterativeParseInit();
+    Next();
+  }
 
-template <>
-void Any::ValueHolder<int>::Dump(Any& any) {
-  any.jsonValue.SetInt(this->value);
-}
+  SaxReader(const SaxReader&) = delete;
+  SaxReader& operator=(const SaxReader&) = delete;
 
-template <typename T>
-typename std::enable_if<std::is_copy_constructible<T>::value, T>::type  //
-AnyCast(Any& any) {
-  T obj;
-  any.Cast(obj);
-  return obj;
-}
+  // Starts over on another document, keeping the buffers grown so far, as
+  // well as the lazy mode, projection and string pool. Values captured
+  // from the last document keep the old arena.
+  void Reset(const char* json, size_t length,
+             std::shared_ptr<Arena> arena = nullptr) {
+    JSON_ANY_STATS_ADD(bytesParsed, length);
+    // The tokenizer only comes out clean from a document read to the end.
+    if (!reader.IterativeParseComplete() || reader.HasParseError()) {
+      using Reader = rapidjson::Reader;
+      reader.~Reader();
+      new (&reader) Reader();
+    }
+    this->arena = std::move(arena);
+    source = json;
+    stream = rapidjson::MemoryStream(json, length);
+    insituStream = detail::InsituMemoryStream(nullptr, 0);
+    insitu = false;
+    token = kEndToken;
+    tokenOffset = 0;
+    stringValue = nullptr;
+    stringLength = 0;
+    status = Status();
+    scopes.clear();
+    valueNode = projection != nullptr ? Projection::Root() : Projection::kNone;
+    stopped = false;
+    reader.IterativeParseInit();
+    Next();
+  }
 
-template <typename T, typename AllocatorType>
-void Dump(rapidjson::Value& array, AllocatorType& alloc, std::vector<T>& v) {
-  using rapidjson::Value;
-  array.SetArray();
-  for (auto& item : v) {
-    Value v;
-    v.SetObject();
-    auto object = v.GetObject();
-    item.Dump(v, alloc);
-    v.Set(object);
-    array.PushBack(v, alloc);
+  bool IsEnd() const { return token == kEndToken; }
+  bool IsNull() const { return token == kScalarToken && scalar.IsNull(); }
+  bool IsBool() const { return token == kScalarToken && scalar.IsBool(); }
+  bool IsNumber() const { return token == kScalarToken && scalar.IsNumber(); }
+  bool IsInt() const { return token == kScalarToken && scalar.IsInt(); }
+  bool IsUint() const { return token == kScalarToken && scalar.IsUint(); }
+  bool IsInt64() const { return token == kScalarToken && scalar.IsInt64(); }
+  bool IsUint64() const { return token == kScalarToken && scalar.IsUint64(); }
+  bool IsDouble() const { return token == kScalarToken && scalar.IsDouble(); }
+  bool IsString() const { return token == kStringToken; }
+  bool IsObject() const { return token == kStartObjectToken; }
+  bool IsArray() const { return token == kStartArrayToken; }
+
+  bool GetBool() const { return scalar.GetBool(); }
+  int GetInt() const { return scalar.GetInt(); }
+  unsigned GetUint() const { return scalar.GetUint(); }
+  int64_t GetInt64() const { return scalar.GetInt64(); }
+  uint64_t GetUint64() const { return scalar.GetUint64(); }
+  double GetDouble() const { return scalar.GetDouble(); }
+  const char* GetString() const { return stringValue; }
+  rapidjson::SizeType GetStringLength() const { return stringLength; }
+
+  // Name of the member whose value is the current token.
+  const std::string& Key() const { return key; }
+
+  // Offset just past the current token in the source text.
+  size_t Tell() const { return insitu ? insituStream.Tell() : stream.Tell(); }
+
+  // In lazy mode json::Any values keep their source text and decode it on
+  // first use instead of building a DOM while parsing.
+  // In-situ parsing rewrites the source, so it never keeps raw text.
+  void SetLazy(bool lazy) { this->lazy = lazy; }
+  bool IsLazy() const { return lazy && !insitu; }
+
+  // Binds only what projection selects, which must outlive the reader. Set
+  // it before reading anything. NextMember then skips members that are not
+  // selected and stops once an object's selected members have all been
+  // read; past the outermost object nothing more is parsed. Hand-written
+  // Parse methods see only the selected members.
+  void SetProjection(const Projection* projection) {
+    this->projection = projection;
+    valueNode = Projection::Root();
+    scopes.reserve(16);
   }
-}
 
-template <typename T, typename Writer>
-std::string Dump(T& obj) {
-  using rapidjson::Document;
-  using rapidjson::StringBuffer;
-  using rapidjson::Value;
-  StringBuffer sb;
-  Writer w(sb);
-  Document doc;
-  Value v;
-  obj.Dump(v, doc.GetAllocator());
-  doc.SetObject();
-  doc.Set(v.GetObject());
-  doc.Accept(w);
-  return sb.GetString();
-}
+  // Under a projection a member may be absent only because it wasn't
+  // selected, so Parse methods should not report missing members then.
+  bool IsProjected() const { return projection != nullptr; }
 
-template <>
-std::string Dump(std::string& obj) {
-  return obj;
-}
+  // Pool for the InternedString values read, which must outlive them. By
+  // default they go to the StringPoolScope pool, or the global one.
+  void SetStringPool(StringPool* pool) { stringPool = pool; }
 
-template <>
-std::string Dump(int& obj) {
-  return std::to_string(obj);
-}
+  // Arena shared by everything captured from this reader.
+  const std::shared_ptr<Arena>& GetArena() {
+    if (arena == nullptr) {
+      arena = std::make_shared<Arena>();
+    }
+    return arena;
+  }
 
-template <typename T>
-std::string Dump(T& obj) {
-  return Dump<T, rapidjson::Writer<rapidjson::StringBuffer>>(obj);
-}
+  bool Failed() const { return !status.Ok(); }
+  const Status& GetStatus() const { return status; }
 
-template <typename T>
-std::string DumpPretty(T& obj) {
-  return Dump<T, rapidjson::PrettyWriter<rapidjson::StringBuffer>>(obj);
-}
+  // Reports an error at the current token and returns false. Throwing
+  // readers raise it as std::invalid_argument instead.
+  bool Fail(ErrorCode code, std::string message) {
+    if (throwing) {
+      throw std::invalid_argument(message);
+    }
+    detail::Fail(status, code, std::move(message), tokenOffset);
+    token = kEndToken;
+    return false;
+  }
 
-template <typename T>
-std::vector<T> ParseArray(const rapidjson::Value& value) {
-  using rapidjson::Value;
-  std::vector<T> ret;
-  if (!value.IsArray()) {
-    throw std::invalid_argument("invalid value");
-  }
-  auto jsonArray = value.GetArray();
-  auto itr = jsonArray.begin();
-  auto end = jsonArray.end();
-  for (; itr != end; itr++) {
-    auto& v = *itr;
-    T obj;
-    obj.Parse(v);
-    ret.push_back(obj);
+  // Reports the failure of a value bound from a DOM of the current token.
+  bool Fail(Status inner) {
+    if (throwing) {
+      inner.Throw();
+    }
+    if (status.Ok()) {
+      inner.offset = tokenOffset;
+      status = std::move(inner);
+    }
+    token = kEndToken;
+    return false;
   }
-  return ret;
-}
 
-template <typename T>
-void Parse(                  //
-    T& obj,                  //
-    const std::string& json  //
+  // Adds the member name or element index a failure unwinds through.
+  void PrefixPath(const char* name, size_t length) {
+    detail::PrefixPath(status, name, length);
+  }
+  void PrefixPath(size_t index) { detail::PrefixPath(status, index); }
+
+  void Next() {
+    if (projection != nullptr) {
+      project();
+    }
+    if (Failed() || stopped || reader.IterativeParseComplete()) {
+      token = kEndToken;
+      return;
+    }
+    tokenOffset = Tell();
+    bool ok = insitu ? reader.IterativeParseNext<rapidjson::kParseInsituFlag>(
+                           insituStream, handler)
+                     : reader.IterativeParseNext<rapidjson::kParseDefaultFlags>(
+                           stream, handler);
+    if (!ok) {
+      std::string err = "Invalid JSON: ";
+      err += rapidjson::GetParseError_En(reader.GetParseErrorCode());
+      err += " at offset " + std::to_string(reader.GetErrorOffset());
+      tokenOffset = reader.GetErrorOffset();
+      Fail(ErrorCode::kSyntax, std::move(err));
+    }
+  }
+
+  bool StartObject() {
+    if (token != kStartObjectToken) {
+      return Fail(ErrorCode::kTypeMismatch, "Invalid JSON: object expected");
+    }
+    Next();
+    return true;
+  }
+
+  // Moves onto the value of the next member, or past the closing brace.
+  bool NextMember() {
+    while (token == kKeyToken) {
+      if (projection != nullptr && membersFound()) {
+        return skipMembers();
+      }
+      Next();
+      if (projection == nullptr || valueNode != Projection::kNone) {
+        return true;
+      }
+      Skip();
+    }
+    if (token == kEndObjectToken) {
+      Next();
+      return false;
+    }
+    return Fail(ErrorCode::kSyntax, "Invalid JSON: member expected");
+  }
+
+  bool StartArray() {
+    if (token != kStartArrayToken) {
+      return Fail(ErrorCode::kTypeMismatch, "Invalid JSON: array expected");
+    }
+    Next();
+    return true;
+  }
+
+  // Returns true while there is an element to read, or moves past the
+  // closing bracket.
+  bool NextElement() {
+    if (token == kEndArrayToken) {
+      Next();
+      return false;
+    }
+    return expectValue();
+  }
+
+  // Skips the current value without keeping track of its text.
+  void Skip() {
+    if (!expectValue()) {
+      return;
+    }
+    size_t depth = 0;
+    do {
+      if (token == kStartObjectToken || token == kStartArrayToken) {
+        depth++;
+      } else if (token == kEndObjectToken || token == kEndArrayToken) {
+        depth--;
+      }
+      Next();
+    } while (depth > 0 && token != kEndToken);
+  }
+
+  // Skips the current value and returns its text in the source.
+  void SkipRaw(const char*& json, size_t& length) {
+    json = source;
+    length = 0;
+    if (!expectValue()) {
+      return;
+    }
+    size_t begin = tokenOffset;
+    while (isSeparator(source[begin])) {
+      begin++;
+    }
+    size_t end = 0;
+    size_t depth = 0;
+    do {
+      if (token == kStartObjectToken || token == kStartArrayToken) {
+        depth++;
+      } else if (token == kEndObjectToken || token == kEndArrayToken) {
+        depth--;
+      }
+      end = Tell();
+      Next();
+    } while (depth > 0 && token != kEndToken);
+    json = source + begin;
+    length = end - begin;
+  }
+
+  bool Read(std::string& s) {
+    if (!IsString()) {
+      return false;
+    }
+    s.assign(stringValue, stringLength);
+    Next();
+    return true;
+  }
+
+  bool Read(InternedString& s) {
+    if (!IsString()) {
+      return false;
+    }
+    s = InternedString(stringValue, stringLength,
+                       stringPool != nullptr ? *stringPool
+                                             : detail::CurrentPool());
+    Next();
+    return true;
+  }
+
+  template <typename T>
+  typename std::enable_if<detail::Primitive<T>::value, bool>::type Read(
+      T& value) {
+    if (token != kScalarToken || !detail::Primitive<T>::Is(scalar)) {
+      return false;
+    }
+    value = detail::Primitive<T>::Get(scalar);
+    Next();
+    return true;
+  }
+
+  // Materializes the current value, and only that value, as a DOM.
+  template <typename AllocatorType>
+  void ReadValue(rapidjson::Value& v, AllocatorType& alloc) {
+    using rapidjson::Value;
+    if (!expectValue()) {
+      return;
+    }
+    JSON_ANY_STATS_ADD(domNodes, 1);
+    switch (token) {
+      case kScalarToken:
+        v.CopyFrom(scalar, alloc);
+        Next();
+        break;
+      case kStringToken:
+        v.SetString(stringValue, stringLength, alloc);
+        Next();
+        break;
+      case kStartObjectToken:
+        v.SetObject();
+        Next();
+        while (token == kKeyToken) {
+          if (projection != nullptr && membersFound()) {
+            skipMembers();
+            return;
+          }
+          Next();
+          if (projection != nullptr && valueNode == Projection::kNone) {
+            Skip();
+            continue;
+          }
+          // The key stays put until the next key token.
+          Value name(key, alloc);
+          Value member;
+          ReadValue(member, alloc);
+          v.AddMember(name, member, alloc);
+        }
+        Next();
+        break;
+      default:
+        v.SetArray();
+        Next();
+        while (token != kEndArrayToken && token != kEndToken) {
+          // Unselected elements stay as nulls to keep the indices.
+          Value element;
+          if (projection != nullptr && valueNode == Projection::kNone) {
+            Skip();
+          } else {
+            ReadValue(element, alloc);
+          }
+          v.PushBack(element, alloc);
+        }
+        Next();
+        break;
+    }
+  }
+
+ private:
+  SaxReader(const char* json, size_t length, std::shared_ptr<Arena> arena,
+            bool throwing)
+      : arena(std::move(arena)),
+        source(json),
+        stream(json, length),
+        insituStream(nullptr, 0),
+        insitu(false),
+        handler(this),
+        token(kEndToken),
+        tokenOffset(0),
+        stringValue(nullptr),
+        stringLength(0),
+        lazy(false),
+        throwing(throwing),
+        projection(nullptr),
+        valueNode(Projection::kNone),
+        stopped(false),
+        stringPool(nullptr) {
+    JSON_ANY_STATS_ADD(bytesParsed, length);
+    reader.IterativeParseInit();
+    Next();
+  }
+
+  enum TokenType {
+    kEndToken,
+    kScalarToken,
+    kStringToken,
+    kKeyToken,
+    kStartObjectToken,
+    kEndObjectToken,
+    kStartArrayToken,
+    kEndArrayToken
+  };
+
+  class Handler
+      : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, Handler> {
+   public:
+    explicit Handler(SaxReader* r) : r(r) {}
+    bool Null() {
+      r->scalar.SetNull();
+      return scalar();
+    }
+    bool Bool(bool b) {
+      r->scalar.SetBool(b);
+      return scalar();
+    }
+    bool Int(int i) {
+      r->scalar.SetInt(i);
+      return scalar();
+    }
+    bool Uint(unsigned u) {
+      r->scalar.SetUint(u);
+      return scalar();
+    }
+    bool Int64(int64_t i) {
+      r->scalar.SetInt64(i);
+      return scalar();
+    }
+    bool Uint64(uint64_t u) {
+      r->scalar.SetUint64(u);
+      return scalar();
+    }
+    bool Double(double d) {
+      r->scalar.SetDouble(d);
+      return scalar();
+    }
+    bool String(const char* s, rapidjson::SizeType length, bool copy) {
+      if (copy) {
+        r->buffer.assign(s, length);
+        s = r->buffer.data();
+      }
+      r->stringValue = s;
+      r->stringLength = length;
+      r->token = kStringToken;
+      return true;
+    }
+    bool Key(const char* s, rapidjson::SizeType length, bool) {
+      r->key.assign(s, length);
+      r->token = kKeyToken;
+      return true;
+    }
+    bool StartObject() { return structural(kStartObjectToken); }
+    bool EndObject(rapidjson::SizeType) { return structural(kEndObjectToken); }
+    bool StartArray() { return structural(kStartArrayToken); }
+    bool EndArray(rapidjson::SizeType) { return structural(kEndArrayToken); }
+
+   private:
+    bool scalar() { return structural(kScalarToken); }
+    bool structural(TokenType t) {
+      r->token = t;
+      return true;
+    }
+    SaxReader* r;
+  };
+
+  // What the parser may consume ahead of a value token.
+  static bool isSeparator(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == ':' ||
+           c == ',';
+  }
+
+  // Tracks the projection node of each value as tokens are consumed. An
+  // array scope counts its elements in found.
+  void project() {
+    switch (token) {
+      case kStartObjectToken:
+        scopes.push_back(Scope{valueNode, 0, false});
+        return;
+      case kStartArrayToken:
+        scopes.push_back(Scope{valueNode, 0, true});
+        valueNode = projection->Element(valueNode, 0);
+        return;
+      case kEndObjectToken:
+      case kEndArrayToken:
+        if (!scopes.empty()) {
+          scopes.pop_back();
+        }
+        break;
+      case kKeyToken: {
+        if (scopes.empty()) {
+          valueNode = Projection::kAll;
+          return;
+        }
+        Scope& scope = scopes.back();
+        size_t index = 0;
+        valueNode =
+            projection->Child(scope.node, key.data(), key.size(), index);
+        if (valueNode != Projection::kNone && index < 64) {
+          scope.found |= uint64_t(1) << index;
+        }
+        return;
+      }
+      default:
+        break;
+    }
+    // A value has ended; an enclosing array moves on to its next element.
+    if (!scopes.empty() && scopes.back().array) {
+      Scope& scope = scopes.back();
+      valueNode = projection->Element(scope.node, ++scope.found);
+    }
+  }
+
+  bool membersFound() const {
+    if (scopes.empty()) {
+      return false;
+    }
+    uint64_t members = projection->Members(scopes.back().node);
+    return members != 0 && (scopes.back().found & members) == members;
+  }
+
+  // Every selected member of the current object has been read. The rest of
+  // it is skipped, or, for the outermost object, not parsed at all.
+  bool skipMembers() {
+    if (scopes.size() == 1) {
+      stopped = true;
+      token = kEndToken;
+      return false;
+    }
+    size_t depth = scopes.size();
+    while (scopes.size() >= depth && token != kEndToken) {
+      Next();
+    }
+    return false;
+  }
+
+  bool expectValue() {
+    if (token == kEndToken || token == kKeyToken || token == kEndObjectToken ||
+        token == kEndArrayToken) {
+      return Fail(ErrorCode::kSyntax, "Invalid JSON: value expected");
+    }
+    return true;
+  }
+
+  std::shared_ptr<Arena> arena;
+  const char* source;
+  rapidjson::Reader reader;
+  rapidjson::MemoryStream stream;
+  detail::InsituMemoryStream insituStream;
+  bool insitu;
+  Handler handler;
+  TokenType token;
+  size_t tokenOffset;
+  rapidjson::Value scalar;
+  const char* stringValue;
+  rapidjson::SizeType stringLength;
+  std::string buffer;
+  std::string key;
+  bool lazy;
+  bool throwing;
+  Status status;
+
+  struct Scope {
+    uint32_t node;
+    uint64_t found;
+    bool array;
+  };
+  const Projection* projection;
+  uint32_t valueNode;
+  std::vector<Scope> scopes;
+  bool stopped;
+  StringPool* stringPool;
+};
+
+namespace detail {
+
+template <typename T, typename = void>
+struct HasSaxParse : std::false_type {};
+
+template <typename T>
+struct HasSaxParse<T, decltype(std::declval<T&>().Parse(
+                          std::declval<SaxReader&>()))> : std::true_type {};
+
+// Non-throwing parse hooks: `bool TryParse(json::SaxReader&)`, reporting
+// through the reader, and `bool TryParse(const rapidjson::Value&, Status&)`.
+template <typename T, typename = void>
+struct HasSaxTryParse : std::false_type {};
+
+template <typename T>
+struct HasSaxTryParse<T, decltype(static_cast<void>(std::declval<T&>().TryParse(
+                             std::declval<SaxReader&>())))> : std::true_type {
+};
+
+template <typename T, typename = void>
+struct HasDomTryParse : std::false_type {};
+
+template <typename T>
+struct HasDomTryParse<T, decltype(static_cast<void>(std::declval<T&>().TryParse(
+                             std::declval<const rapidjson::Value&>(),
+                             std::declval<Status&>())))> : std::true_type {};
+
+template <typename T, typename Writer, typename = void>
+struct HasWrite : std::false_type {};
+
+template <typename T, typename Writer>
+struct HasWrite<T, Writer,
+                decltype(std::declval<T&>().Write(std::declval<Writer&>()))>
+    : std::true_type {};
+
+// Raw JSON text is only spliced into compact output. A pretty writer would
+// emit it with the source's own whitespace.
+template <typename Writer>
+struct IsPrettyWriter : std::false_type {};
+
+template <typename OutputStream, typename SourceEncoding,
+          typename TargetEncoding, typename StackAllocator,
+          unsigned writeFlags>
+struct IsPrettyWriter<rapidjson::PrettyWriter<
+    OutputStream, SourceEncoding, TargetEncoding, StackAllocator, writeFlags>>
+    : std::true_type {};
+
+// The same writer type over another output stream.
+template <typename Writer, typename Stream>
+struct RebindWriter;
+
+template <typename OutputStream, typename SourceEncoding,
+          typename TargetEncoding, typename StackAllocator,
+          unsigned writeFlags, typename Stream>
+struct RebindWriter<rapidjson::Writer<OutputStream, SourceEncoding,
+                                      TargetEncoding, StackAllocator,
+                                      writeFlags>,
+                    Stream> {
+  using Type = rapidjson::Writer<Stream, SourceEncoding, TargetEncoding,
+                                 StackAllocator, writeFlags>;
+};
+
+template <typename OutputStream, typename SourceEncoding,
+          typename TargetEncoding, typename StackAllocator,
+          unsigned writeFlags, typename Stream>
+struct RebindWriter<rapidjson::PrettyWriter<OutputStream, SourceEncoding,
+                                            TargetEncoding, StackAllocator,
+                                            writeFlags>,
+                    Stream> {
+  using Type = rapidjson::PrettyWriter<Stream, SourceEncoding, TargetEncoding,
+                                       StackAllocator, writeFlags>;
+};
+
+}  // namespace detail
+
+template <typename T, typename AllocatorType>
+void Dump(rapidjson::Value& array, AllocatorType& alloc, std::vector<T>& v);
+
+template <typename AllocatorType>
+void Dump(rapidjson::Value& array, AllocatorType& alloc, std::vector<bool>& v);
+
+namespace detail {
+
+// Set while json::ParseInto runs on this thread. Vectors are then bound over
+// the elements they already hold instead of being cleared first; the flag
+// follows the parse through hand-written Parse methods, which a reader or
+// Status argument would not.
+inline bool& BindingInPlace() {
+  static thread_local bool inPlace = false;
+  return inPlace;
+}
+
+// Sets BindingInPlace until the end of the scope. ParseInto turns it on;
+// every other entry point turns it off, so a parse nested in a ParseInto,
+// from a hand-written Parse method or a cast, binds fresh values.
+class InPlaceScope final {
+ public:
+  explicit InPlaceScope(bool inPlace) : saved(BindingInPlace()) {
+    BindingInPlace() = inPlace;
+  }
+  ~InPlaceScope() { BindingInPlace() = saved; }
+
+  InPlaceScope(const InPlaceScope&) = delete;
+  InPlaceScope& operator=(const InPlaceScope&) = delete;
+
+ private:
+  bool saved;
+};
+
+// DumpValue and BindValue convert any bindable type to and from a DOM value:
+// primitives, strings, vectors and types with Dump and Parse methods.
+template <typename T, typename AllocatorType>
+void DumpValue(rapidjson::Value& v, AllocatorType& alloc, T& obj,
+               std::false_type) {
+  obj.Dump(v, alloc);
+}
+
+template <typename T, typename AllocatorType>
+void DumpValue(rapidjson::Value& v, AllocatorType&, T& obj, std::true_type) {
+  Primitive<T>::Set(v, obj);
+}
+
+template <typename T, typename AllocatorType>
+void DumpValue(rapidjson::Value& v, AllocatorType& alloc, T& obj) {
+  DumpValue(v, alloc, obj, Primitive<T>());
+}
+
+template <typename AllocatorType>
+void DumpValue(rapidjson::Value& v, AllocatorType& alloc, std::string& obj) {
+  v.SetString(obj, alloc);
+}
+
+template <typename T, typename AllocatorType>
+void DumpValue(rapidjson::Value& v, AllocatorType& alloc, std::vector<T>& obj) {
+  json::Dump(v, alloc, obj);
+}
+
+// TryBindValue is BindValue reporting failures into status. Types without
+// a TryParse hook fall back to catching what their Parse throws.
+template <typename T>
+typename std::enable_if<Primitive<T>::value, bool>::type TryBindValue(
+    T& obj, const rapidjson::Value& v, Status& status) {
+  if (!Primitive<T>::Is(v)) {
+    return Fail(status, ErrorCode::kTypeMismatch, "Invalid Type in JSON");
+  }
+  obj = Primitive<T>::Get(v);
+  return true;
+}
+
+template <typename T>
+typename std::enable_if<HasDomTryParse<T>::value, bool>::type TryBindValue(
+    T& obj, const rapidjson::Value& v, Status& status) {
+  return obj.TryParse(v, status);
+}
+
+template <typename T>
+typename std::enable_if<!Primitive<T>::value && !HasDomTryParse<T>::value,
+                        bool>::type
+TryBindValue(T& obj, const rapidjson::Value& v, Status& status) {
+  try {
+    obj.Parse(v);
+  } catch (const std::invalid_argument& e) {
+    return Fail(status, ErrorCode::kTypeMismatch, e.what());
+  }
+  return true;
+}
+
+inline bool TryBindValue(std::string& obj, const rapidjson::Value& v,
+                         Status& status) {
+  if (!v.IsString()) {
+    return Fail(status, ErrorCode::kTypeMismatch, "Invalid Type in JSON");
+  }
+  obj.assign(v.GetString(), v.GetStringLength());
+  return true;
+}
+
+inline bool TryBindValue(std::vector<bool>& obj, const rapidjson::Value& v,
+                         Status& status) {
+  if (!v.IsArray()) {
+    return Fail(status, ErrorCode::kTypeMismatch, "invalid value");
+  }
+  obj.clear();
+  obj.reserve(v.Size());
+  for (rapidjson::SizeType i = 0; i < v.Size(); i++) {
+    if (!v[i].IsBool()) {
+      Fail(status, ErrorCode::kTypeMismatch, "Invalid Type in JSON");
+      PrefixPath(status, i);
+      return false;
+    }
+    obj.push_back(v[i].GetBool());
+  }
+  return true;
+}
+
+// Elements are bound into fresh ones, except under ParseInto, where they
+// are bound over the ones already there and extra elements are dropped.
+template <typename T>
+bool TryBindValue(std::vector<T>& obj, const rapidjson::Value& v,
+                  Status& status) {
+  if (!v.IsArray()) {
+    return Fail(status, ErrorCode::kTypeMismatch, "invalid value");
+  }
+  if (BindingInPlace()) {
+    obj.resize(v.Size());
+  } else {
+    obj.clear();
+    obj.reserve(v.Size());
+  }
+  for (rapidjson::SizeType i = 0; i < v.Size(); i++) {
+    if (i == obj.size()) {
+      obj.emplace_back();
+    }
+    if (!TryBindValue(obj[i], v[i], status)) {
+      PrefixPath(status, i);
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename T>
+void BindValue(T& obj, const rapidjson::Value& v) {
+  Status status;
+  if (!TryBindValue(obj, v, status)) {
+    status.Throw();
+  }
+}
+
+// TryParseValue binds obj from the current value of reader, through the
+// reader's own error reporting.
+template <typename T>
+typename std::enable_if<Primitive<T>::value, bool>::type TryParseValue(
+    T& obj, SaxReader& reader) {
+  return reader.Read(obj) ||
+         reader.Fail(ErrorCode::kTypeMismatch, "Invalid Type in JSON");
+}
+
+template <typename T>
+typename std::enable_if<HasSaxTryParse<T>::value, bool>::type TryParseValue(
+    T& obj, SaxReader& reader) {
+  return obj.TryParse(reader);
+}
+
+template <typename T>
+typename std::enable_if<HasSaxParse<T>::value && !HasSaxTryParse<T>::value,
+                        bool>::type
+TryParseValue(T& obj, SaxReader& reader) {
+  try {
+    obj.Parse(reader);
+  } catch (const std::invalid_argument& e) {
+    return reader.Fail(ErrorCode::kTypeMismatch, e.what());
+  }
+  return !reader.Failed();
+}
+
+// Types that only bind from a DOM get the current value as one.
+template <typename T>
+typename std::enable_if<!Primitive<T>::value && !HasSaxParse<T>::value &&
+                            !HasSaxTryParse<T>::value,
+                        bool>::type
+TryParseValue(T& obj, SaxReader& reader) {
+  rapidjson::Document doc;
+  reader.ReadValue(doc, doc.GetAllocator());
+  if (reader.Failed()) {
+    return false;
+  }
+  Status status;
+  return TryBindValue(obj, doc, status) || reader.Fail(std::move(status));
+}
+
+inline bool TryParseValue(std::string& obj, SaxReader& reader) {
+  return reader.Read(obj) ||
+         reader.Fail(ErrorCode::kTypeMismatch, "Invalid Type in JSON");
+}
+
+inline bool TryParseValue(std::vector<bool>& obj, SaxReader& reader) {
+  if (!reader.IsArray()) {
+    return reader.Fail(ErrorCode::kTypeMismatch, "invalid value");
+  }
+  obj.clear();
+  reader.StartArray();
+  for (size_t i = 0; reader.NextElement(); i++) {
+    bool item;
+    if (!TryParseValue(item, reader)) {
+      reader.PrefixPath(i);
+      return false;
+    }
+    obj.push_back(item);
+  }
+  return !reader.Failed();
+}
+
+// Like the DOM form. Projected parses always start from fresh elements,
+// which would otherwise keep stale unselected members.
+template <typename T>
+bool TryParseValue(std::vector<T>& obj, SaxReader& reader) {
+  if (!reader.IsArray()) {
+    return reader.Fail(ErrorCode::kTypeMismatch, "invalid value");
+  }
+  if (!BindingInPlace() || reader.IsProjected()) {
+    obj.clear();
+  }
+  reader.StartArray();
+  size_t size = 0;
+  for (; reader.NextElement(); size++) {
+    if (size == obj.size()) {
+      obj.emplace_back();
+    }
+    if (!TryParseValue(obj[size], reader)) {
+      reader.PrefixPath(size);
+      return false;
+    }
+  }
+  obj.erase(obj.begin() + static_cast<std::ptrdiff_t>(size), obj.end());
+  return !reader.Failed();
+}
+
+}  // namespace detail
+
+template <typename T>
+typename std::enable_if<detail::HasSaxParse<T>::value>::type Parse(  //
+    T& obj,                                                          //
+    SaxReader& reader                                                //
+);
+
+template <typename T>
+typename std::enable_if<detail::Primitive<T>::value>::type Parse(  //
+    T& obj,                                                        //
+    SaxReader& reader                                              //
+);
+
+template <typename T>
+typename std::enable_if<!detail::HasSaxParse<T>::value &&
+                        !detail::Primitive<T>::value>::type
+Parse(                 //
+    T& obj,            //
+    SaxReader& reader  //
+);
+
+class FrozenAny;
+
+// Dump and Write are const and, like other reads, safe to call on one Any,
+// or on copies sharing a held value, from many threads at once. Nothing
+// may change the Any or its held value meanwhile; FrozenAny guarantees
+// that.
+class Any final {
+ public:
+  Any() : holder(nullptr), jsonValue(nullptr), raw(nullptr) { emptyMemo(); }
+
+  Any(const Any& any)
+      : holder(nullptr),
+        arena(any.arena),
+        jsonValue(any.jsonValue),
+        raw(any.raw) {
+    emptyMemo();
+    if (any.holder != nullptr) {
+      JSON_ANY_STATS_ADD(anyDeepCopies, 1);
+      any.holder->clone(any, *this);
+    }
+  }
+
+  Any(Any&& any) noexcept
+      : holder(nullptr),
+        arena(std::move(any.arena)),
+        jsonValue(any.jsonValue),
+        raw(any.raw) {
+    emptyMemo();
+    takeHolder(any);
+    any.jsonValue = nullptr;
+    any.raw = nullptr;
+  }
+
+  template <typename T>
+  Any(const std::shared_ptr<T> p)
+      : holder(nullptr), jsonValue(nullptr), raw(nullptr) {
+    emptyMemo();
+    newHolder<SharedPointerHolder<T>>(p);
+  }
+
+  template <typename T>
+  Any(const T& v) : holder(nullptr), jsonValue(nullptr), raw(nullptr) {
+    emptyMemo();
+    newHolder<ValueHolder<T>>(v);
+  }
+
+  Any(const char* s) : Any(std::string(s)) {}
+
+  ~Any() { resetHolder(); }
+
+  Any& operator=(const Any& any) {
+    Any(any).Swap(*this);
+    return *this;
+  }
+
+  Any& operator=(Any&& any) noexcept {
+    Any(std::move(any)).Swap(*this);
+    return *this;
+  }
+
+  template <typename T>
+  Any& operator=(const T& o) {
+    Any(o).Swap(*this);
+    return *this;
+  }
+
+  template <typename T>
+  Any& operator=(const std::shared_ptr<T> p) {
+    Any(p).Swap(*this);
+    return *this;
+  }
+
+  void Swap(Any& any) noexcept {
+    if (this == &any) {
+      return;
+    }
+    Any tmp;
+    tmp.takeHolder(*this);
+    takeHolder(any);
+    any.takeHolder(tmp);
+    arena.swap(any.arena);
+    std::swap(jsonValue, any.jsonValue);
+    std::swap(raw, any.raw);
+  }
+
+#if JSON_ANY_RTTI
+  const std::type_info& TypeInfo() const {
+    return holder != nullptr ? holder->typeInfo() : typeid(void);
+  }
+#endif  // JSON_ANY_RTTI
+
+  // Whether a T is held. Parsed JSON holds nothing until it is cast.
+  template <typename T>
+  bool Is() const {
+    return holder != nullptr && holder->typeId == typeIdOf<T>();
+  }
+
+  template <typename T>
+  void Cast(T& t) {
+    checkHolder<T>();
+    holder->copyOut(*this, &t);
+  }
+
+  // Cast that returns false instead of throwing std::bad_cast. Parsed JSON
+  // that does not bind to a T stays as it is.
+  template <typename T>
+  bool TryCast(T& t) {
+    jsonToHolder<T>();
+    if (!Is<T>()) {
+      return false;
+    }
+    holder->copyOut(*this, &t);
+    return true;
+  }
+
+  // Borrows the held T without copying. Parsed JSON is bound to a T first.
+  // The T may be changed through the reference, so the JSON it was bound
+  // from, or that was cached for it, is dropped.
+  template <typename T>
+  T& Ref() {
+    checkHolder<T>();
+    Invalidate();
+    return *static_cast<T*>(holder->get(*this));
+  }
+
+  // JSON the value was parsed from is dumped in preference to a T cast from
+  // it, which may not model every member.
+  template <typename AllocatorType>
+  void Dump(rapidjson::Value& v, AllocatorType& alloc) const {
+    if (jsonValue != nullptr) {
+      v.CopyFrom(*jsonValue, alloc);
+    } else if (raw != nullptr && holder != nullptr) {
+      SaxReader reader(raw->json, raw->length);
+      reader.ReadValue(v, alloc);
+    } else if (raw != nullptr) {
+      v.CopyFrom(decoded(), alloc);
+    } else if (holder != nullptr) {
+      Arena arena;
+      rapidjson::Value value;
+      holder->dump(*this, value, arena);
+      v.CopyFrom(value, alloc);
+    } else {
+      v.SetNull();
+    }
+  }
+
+  // Dumping into an arena builds the held value in place, no copy needed.
+  void Dump(rapidjson::Value& v, Arena& alloc) const {
+    if (!hasJson() && holder != nullptr) {
+      holder->dump(*this, v, alloc);
+      return;
+    }
+    Dump<Arena>(v, alloc);
+  }
+
+  // Picks the same source as Dump.
+  template <typename Writer>
+  void Write(Writer& w) const {
+    if (raw != nullptr && canSplice(w)) {
+      w.RawValue(raw->json, raw->length, raw->type);
+    } else if (jsonValue != nullptr) {
+      jsonValue->Accept(w);
+    } else if (raw != nullptr && holder != nullptr) {
+      Arena arena;
+      rapidjson::Value value;
+      SaxReader reader(raw->json, raw->length);
+      reader.ReadValue(value, arena);
+      value.Accept(w);
+    } else if (raw != nullptr) {
+      decoded().Accept(w);
+    } else if (holder != nullptr) {
+      WriterAdapter<Writer> adapter(w);
+      holder->write(*this, adapter);
+    } else {
+      w.Null();
+    }
+  }
+
+  // Snapshot of the current JSON, see FrozenAny.
+  FrozenAny Freeze() const;
+
+  // Keeps the compact encoding of the value, which compact writers then
+  // splice as is. Nothing is re-encoded while version matches the cached
+  // one, so bump it, or call Invalidate(), after changing a held value
+  // through its shared_ptr. Ref drops the cache itself.
+  void CacheEncoded(uint64_t version = 0) {
+    if (raw != nullptr && (raw->version == version || holder == nullptr)) {
+      return;
+    }
+    if (holder == nullptr && jsonValue == nullptr) {
+      return;
+    }
+    rapidjson::StringBuffer sb;
+    rapidjson::Writer<rapidjson::StringBuffer> w(sb);
+    if (jsonValue != nullptr) {
+      jsonValue->Accept(w);
+    } else {
+      WriterAdapter<rapidjson::Writer<rapidjson::StringBuffer>> adapter(w);
+      holder->write(*this, adapter);
+    }
+    // The arena may be shared with siblings read on other threads, so the
+    // encoding replaces the value in a private one.
+    auto encoded = std::make_shared<Arena>(kPrivateArenaChunkCapacity);
+    raw = newRaw(*encoded, sb.GetString(), sb.GetSize(), version);
+    arena = std::move(encoded);
+    jsonValue = nullptr;
+  }
+
+  // Drops the JSON memoized from a held value, for when it has changed.
+  // Values that are only JSON can't change and keep theirs.
+  void Invalidate() {
+    if (holder == nullptr) {
+      return;
+    }
+    arena.reset();
+    jsonValue = nullptr;
+    raw = nullptr;
+  }
+
+  void Parse(const rapidjson::Value& v) {
+    Parse(v, std::make_shared<Arena>(kPrivateArenaChunkCapacity));
+  }
+
+  // Copies v into a caller-supplied arena, e.g. one shared per request.
+  void Parse(const rapidjson::Value& v, std::shared_ptr<Arena> arena) {
+    rapidjson::Value* value = newValue(*arena);
+    value->CopyFrom(v, *arena);
+    setJson(std::move(arena), value);
+  }
+
+  // Takes over v without copying. v must have been built in arena.
+  void Parse(rapidjson::Value&& v, std::shared_ptr<Arena> arena) {
+    rapidjson::Value* value = newValue(*arena);
+    *value = v;
+    setJson(std::move(arena), value);
+  }
+
+  void Parse(SaxReader& reader) {
+    const std::shared_ptr<Arena>& arena = reader.GetArena();
+    if (reader.IsLazy()) {
+      const char* json;
+      size_t length;
+      reader.SkipRaw(json, length);
+      setRaw(arena, json, length);
+      return;
+    }
+    rapidjson::Value* value = newValue(*arena);
+    reader.ReadValue(*value, *arena);
+    setJson(arena, value);
+  }
+
+ private:
+  enum { kPrivateArenaChunkCapacity = 1024 };
+
+  // Identifies a type by the address of a per-type tag, so type checks are
+  // a pointer compare and work without RTTI.
+  using TypeId = const void*;
+
+  template <typename T>
+  struct TypeTag {
+    static char id;
+  };
+
+  template <typename T>
+  static TypeId typeIdOf() {
+    return &TypeTag<T>::id;
+  }
+
+  template <typename T>
+  void checkHolder() {
+    jsonToHolder<T>();
+    if (!Is<T>()) {
+      throw std::bad_cast();
+    }
+  }
+
+  template <typename T>
+  bool jsonToHolder() {
+    if (holder != nullptr || !hasJson() || isNullJson()) {
+      return false;
+    }
+    JSON_ANY_STATS_TIME(kJsonToHolder);
+    JSON_ANY_STATS_ADD(holderAllocations, 1);
+    detail::InPlaceScope scope(false);
+    std::shared_ptr<T> value(new T());
+    bool ok;
+    if (raw != nullptr) {
+      // Nested Anys get a private arena, not the one this value shares.
+      SaxReader reader(NoThrowTag(), raw->json, raw->length,
+                       std::make_shared<Arena>(kPrivateArenaChunkCapacity));
+      reader.SetLazy(true);
+      ok = detail::TryParseValue(*value, reader);
+    } else {
+      Status status;
+      ok = detail::TryBindValue(*value, *this->jsonValue, status);
+    }
+    if (!ok) {
+      return false;
+    }
+    newHolder<SharedPointerHolder<T>>(std::move(value));
+    return true;
+  }
+
+  static rapidjson::Value* newValue(Arena& arena) {
+    return new (arena.Malloc(sizeof(rapidjson::Value))) rapidjson::Value();
+  }
+
+  // Steals the holder of any, or its memo, which must not be this. Leaves
+  // any empty.
+  void takeHolder(Any& any) noexcept {
+    resetHolder();
+    if (any.holder == nullptr) {
+      memo().store(any.memo().exchange(nullptr, std::memory_order_relaxed),
+                   std::memory_order_relaxed);
+      return;
+    }
+    any.holder->move(any, *this);
+    holder = any.holder;
+    any.holder = nullptr;
+    any.emptyMemo();
+  }
+
+  // Drops the holder, or the memo of an Any without one.
+  void resetHolder() noexcept {
+    if (holder == nullptr) {
+      delete memo().exchange(nullptr, std::memory_order_relaxed);
+      return;
+    }
+    holder->destroy(*this);
+    holder = nullptr;
+    emptyMemo();
+  }
+
+  void setJson(std::shared_ptr<Arena> arena, const rapidjson::Value* value) {
+    resetHolder();
+    this->arena = std::move(arena);
+    this->jsonValue = value;
+    this->raw = nullptr;
+  }
+
+  // Source text of a lazily parsed value, or the cached encoding of a held
+  // one, copied into the arena.
+  struct RawJson {
+    const char* json;
+    size_t length;
+    rapidjson::Type type;
+    uint64_t version;
+  };
+
+  static const RawJson* newRaw(Arena& arena, const char* json, size_t length,
+                               uint64_t version) {
+    char* copy = static_cast<char*>(arena.Malloc(sizeof(RawJson) + length));
+    memcpy(copy + sizeof(RawJson), json, length);
+    return new (copy) RawJson{copy + sizeof(RawJson), length,
+                              rawTypeOf(json[0]), version};
+  }
+
+  void setRaw(const std::shared_ptr<Arena>& arena, const char* json,
+              size_t length) {
+    const RawJson* raw = newRaw(*arena, json, length, 0);
+    resetHolder();
+    this->arena = arena;
+    this->jsonValue = nullptr;
+    this->raw = raw;
+  }
+
+  static rapidjson::Type rawTypeOf(char c) {
+    switch (c) {
+      case '{':
+        return rapidjson::kObjectType;
+      case '[':
+        return rapidjson::kArrayType;
+      case '"':
+        return rapidjson::kStringType;
+      case 't':
+        return rapidjson::kTrueType;
+      case 'f':
+        return rapidjson::kFalseType;
+      case 'n':
+        return rapidjson::kNullType;
+      default:
+        return rapidjson::kNumberType;
+    }
+  }
+
+  bool hasJson() const { return jsonValue != nullptr || raw != nullptr; }
+
+  bool isNullJson() const {
+    if (raw != nullptr) {
+      return raw->type == rapidjson::kNullType;
+    }
+    return jsonValue->IsNull();
+  }
+
+  // DOM of a lazy value, built in its own arena since the shared one isn't
+  // thread-safe.
+  struct Memo {
+    Memo() : arena(kPrivateArenaChunkCapacity) {}
+    Arena arena;
+    rapidjson::Value value;
+  };
+
+  // Builds the memo the first time it is needed. Concurrent readers may
+  // each build one; the first to publish wins and the others drop theirs,
+  // so readers never wait on each other.
+  const rapidjson::Value& decoded() const {
+    const Memo* current = memo().load(std::memory_order_acquire);
+    if (current != nullptr) {
+      return current->value;
+    }
+    JSON_ANY_STATS_TIME(kTokenize);
+    std::unique_ptr<Memo> fresh(new Memo());
+    SaxReader reader(raw->json, raw->length);
+    reader.ReadValue(fresh->value, fresh->arena);
+    if (memo().compare_exchange_strong(current, fresh.get(),
+                                       std::memory_order_acq_rel,
+                                       std::memory_order_acquire)) {
+      current = fresh.release();
+    }
+    return current->value;
+  }
+
+  // An Any without a holder keeps the memo in the unused holder storage.
+  using MemoSlot = std::atomic<const Memo*>;
+
+  MemoSlot& memo() const {
+    return *reinterpret_cast<MemoSlot*>(const_cast<Storage*>(&storage));
+  }
+
+  void emptyMemo() noexcept { new (&storage) MemoSlot(nullptr); }
+
+  template <typename Writer>
+  static bool canSplice(Writer&) {
+    return !detail::IsPrettyWriter<Writer>::value;
+  }
+
+  class WriterInterface;
+
+  static bool canSplice(WriterInterface& w);
+
+ private:
+  // Lets type-erased holders stream into any rapidjson-style writer.
+  class WriterInterface {
+   public:
+    virtual bool Null() = 0;
+    virtual bool Bool(bool b) = 0;
+    virtual bool Int(int i) = 0;
+    virtual bool Uint(unsigned u) = 0;
+    virtual bool Int64(int64_t i) = 0;
+    virtual bool Uint64(uint64_t u) = 0;
+    virtual bool Double(double d) = 0;
+    virtual bool RawNumber(const char* s, rapidjson::SizeType length,
+                           bool copy = false) = 0;
+    virtual bool String(const char* s, rapidjson::SizeType length,
+                        bool copy = false) = 0;
+    virtual bool StartObject() = 0;
+    virtual bool Key(const char* s, rapidjson::SizeType length,
+                     bool copy = false) = 0;
+    virtual bool EndObject(rapidjson::SizeType memberCount = 0) = 0;
+    virtual bool StartArray() = 0;
+    virtual bool EndArray(rapidjson::SizeType elementCount = 0) = 0;
+    virtual bool RawValue(const char* json, size_t length,
+                          rapidjson::Type type) = 0;
+    virtual bool CanSplice() const = 0;
+    bool String(const std::string& s) {
+      return String(s.data(), static_cast<rapidjson::SizeType>(s.size()));
+    }
+    bool String(const char* const& s) {
+      return String(s, static_cast<rapidjson::SizeType>(strlen(s)));
+    }
+    bool Key(const std::string& s) {
+      return Key(s.data(), static_cast<rapidjson::SizeType>(s.size()));
+    }
+    bool Key(const char* const& s) {
+      return Key(s, static_cast<rapidjson::SizeType>(strlen(s)));
+    }
+    virtual ~WriterInterface() {}
+  };
+
+  template <typename Writer>
+  class WriterAdapter : public WriterInterface {
+   public:
+    explicit WriterAdapter(Writer& w) : w(w) {}
+    virtual bool Null() { return w.Null(); }
+    virtual bool Bool(bool b) { return w.Bool(b); }
+    virtual bool Int(int i) { return w.Int(i); }
+    virtual bool Uint(unsigned u) { return w.Uint(u); }
+    virtual bool Int64(int64_t i) { return w.Int64(i); }
+    virtual bool Uint64(uint64_t u) { return w.Uint64(u); }
+    virtual bool Double(double d) { return w.Double(d); }
+    virtual bool RawNumber(const char* s, rapidjson::SizeType length,
+                           bool copy) {
+      return w.RawNumber(s, length, copy);
+    }
+    virtual bool String(const char* s, rapidjson::SizeType length, bool copy) {
+      return w.String(s, length, copy);
+    }
+    virtual bool StartObject() { return w.StartObject(); }
+    virtual bool Key(const char* s, rapidjson::SizeType length, bool copy) {
+      return w.Key(s, length, copy);
+    }
+    virtual bool EndObject(rapidjson::SizeType memberCount) {
+      return w.EndObject(memberCount);
+    }
+    virtual bool StartArray() { return w.StartArray(); }
+    virtual bool EndArray(rapidjson::SizeType elementCount) {
+      return w.EndArray(elementCount);
+    }
+    virtual bool RawValue(const char* json, size_t length,
+                          rapidjson::Type type) {
+      return w.RawValue(json, length, type);
+    }
+    virtual bool CanSplice() const { return canSplice(w); }
+
+   private:
+    Writer& w;
+  };
+
+  template <typename ValueType>
+  class ValueHolder {
+   public:
+    using Type = ValueType;
+    // ValueType is copy constructible
+    ValueHolder(                                           //
+        const typename std::enable_if<                     //
+            std::is_copy_constructible<ValueType>::value,  //
+            ValueType>::type& v)
+        : value(v) {}
+    void Dump(rapidjson::Value& v, Arena& alloc) {
+      detail::DumpValue(v, alloc, value);
+    }
+    void Write(WriterInterface& w) { json::Write(w, value); }
+    void CopyOut(ValueType& v) { v = value; }
+    ValueType* Get() { return &value; }
+    ValueType value;
+  };
+
+  template <typename ValueType>
+  class SharedPointerHolder {
+   public:
+    using Type = ValueType;
+    // ValueType must be default constructible
+    SharedPointerHolder() : value(new ValueType()) {}
+    // ValueType is wrapped inside a shared pointer
+    SharedPointerHolder(const std::shared_ptr<ValueType>& v) : value(v) {}
+    SharedPointerHolder(std::shared_ptr<ValueType>&& v) : value(std::move(v)) {}
+    void Dump(rapidjson::Value& v, Arena& alloc) {
+      detail::DumpValue(v, alloc, *value);
+    }
+    void Write(WriterInterface& w) { json::Write(w, *value); }
+    void CopyOut(ValueType& v) {
+      copyOut(v, std::is_copy_assignable<ValueType>());
+    }
+    ValueType* Get() { return value.get(); }
+
+   private:
+    void copyOut(ValueType& v, std::true_type) { v = *value; }
+    // Types that can't be assigned are rebuilt from their JSON.
+    void copyOut(ValueType& v, std::false_type) {
+      JSON_ANY_STATS_TIME(kCopyOut);
+      JSON_ANY_STATS_ADD(castRoundTrips, 1);
+      auto jsonString = json::Dump<ValueType>(*value);
+      json::Parse(v, jsonString);
+    }
+
+   public:
+    std::shared_ptr<ValueType> value;
+  };
+
+  // Room for a std::string or a shared pointer, like std::any's buffer.
+  // Larger holders are allocated and storage keeps the pointer.
+  using Storage =
+      std::aligned_storage<sizeof(std::string), alignof(void*)>::type;
+
+  // Small holders that move without throwing live in storage instead of on
+  // the heap, which covers ints, short strings and shared pointers.
+  template <typename Holder>
+  static constexpr bool isInline() {
+    return sizeof(Holder) <= sizeof(Storage) &&
+           alignof(Holder) <= alignof(Storage) &&
+           std::is_nothrow_move_constructible<Holder>::value;
+  }
+
+  // Hand-rolled vtable shared by every Any holding the same holder type.
+  struct HolderOps {
+    TypeId typeId;
+#if JSON_ANY_RTTI
+    const std::type_info& (*typeInfo)();
+#endif  // JSON_ANY_RTTI
+    void (*clone)(const Any& from, Any& to);
+    void (*move)(Any& from, Any& to);
+    void (*destroy)(Any& any);
+    void (*dump)(const Any& any, rapidjson::Value& v, Arena& alloc);
+    void (*write)(const Any& any, WriterInterface& w);
+    void (*copyOut)(Any& any, void* v);
+    void* (*get)(Any& any);
+  };
+
+  template <typename Holder>
+  struct HolderOpsOf {
+    using Type = typename Holder::Type;
+    using Inline = std::integral_constant<bool, isInline<Holder>()>;
+
+    static const HolderOps* Get() {
+      static const HolderOps ops = {
+          typeIdOf<Type>(),
+#if JSON_ANY_RTTI
+          &typeInfo,
+#endif  // JSON_ANY_RTTI
+          &clone,
+          &move,
+          &destroy,
+          &dump,
+          &write,
+          &copyOut,
+          &get,
+      };
+      return &ops;
+    }
+
+    static Holder& holderOf(const Any& any) {
+      return holderOf(const_cast<Storage*>(&any.storage), Inline());
+    }
+    static Holder& holderOf(void* storage, std::true_type) {
+      return *static_cast<Holder*>(storage);
+    }
+    static Holder& holderOf(void* storage, std::false_type) {
+      return **static_cast<Holder**>(storage);
+    }
+
+#if JSON_ANY_RTTI
+    static const std::type_info& typeInfo() { return typeid(Type); }
+#endif  // JSON_ANY_RTTI
+    static void clone(const Any& from, Any& to) {
+      to.newHolder<Holder>(holderOf(from));
+    }
+    static void move(Any& from, Any& to) { move(from, to, Inline()); }
+    static void move(Any& from, Any& to, std::true_type) {
+      new (&to.storage) Holder(std::move(holderOf(from)));
+      holderOf(from).~Holder();
+    }
+    // Heap holders just hand over the pointer kept in storage.
+    static void move(Any& from, Any& to, std::false_type) {
+      new (&to.storage) Holder*(&holderOf(from));
+    }
+    static void destroy(Any& any) { destroy(any, Inline()); }
+    static void destroy(Any& any, std::true_type) { holderOf(any).~Holder(); }
+    static void destroy(Any& any, std::false_type) { delete &holderOf(any); }
+    static void dump(const Any& any, rapidjson::Value& v, Arena& alloc) {
+      holderOf(any).Dump(v, alloc);
+    }
+    static void write(const Any& any, WriterInterface& w) {
+      holderOf(any).Write(w);
+    }
+    static void copyOut(Any& any, void* v) {
+      holderOf(any).CopyOut(*static_cast<Type*>(v));
+    }
+    static void* get(Any& any) { return holderOf(any).Get(); }
+  };
+
+  // Builds a holder for an Any without one.
+  template <typename Holder, typename... Args>
+  void newHolder(Args&&... args) {
+    resetHolder();
+    try {
+      newHolder<Holder>(typename HolderOpsOf<Holder>::Inline(),
+                        std::forward<Args>(args)...);
+    } catch (...) {
+      emptyMemo();
+      throw;
+    }
+    holder = HolderOpsOf<Holder>::Get();
+  }
+
+  template <typename Holder, typename... Args>
+  void newHolder(std::true_type, Args&&... args) {
+    new (&storage) Holder(std::forward<Args>(args)...);
+  }
+
+  template <typename Holder, typename... Args>
+  void newHolder(std::false_type, Args&&... args) {
+    JSON_ANY_STATS_ADD(holderAllocations, 1);
+    new (&storage) Holder*(new Holder(std::forward<Args>(args)...));
+  }
+
+  const HolderOps* holder;
+  Storage storage;
+
+ private:
+  // JSON form of the value, immutable once set and owned by arena, so copies
+  // of an Any share it instead of copying the tree.
+  std::shared_ptr<Arena> arena;
+  const rapidjson::Value* jsonValue;
+  const RawJson* raw;
+
+  friend class FrozenAny;
+};
+
+inline void swap(Any& a, Any& b) noexcept { a.Swap(b); }
+
+inline bool Any::canSplice(WriterInterface& w) { return w.CanSplice(); }
+
+template <typename T>
+char Any::TypeTag<T>::id;
+
+template <typename T>
+typename std::enable_if<std::is_copy_constructible<T>::value, T>::type  //
+AnyCast(Any& any) {
+  T obj;
+  any.Cast(obj);
+  return obj;
+}
+
+template <typename T>
+T& AnyRef(Any& any) {
+  return any.Ref<T>();
+}
+
+template <typename T, typename AllocatorType>
+void Dump(rapidjson::Value& array, AllocatorType& alloc, std::vector<T>& v) {
+  using rapidjson::Value;
+  array.SetArray();
+  array.Reserve(static_cast<rapidjson::SizeType>(v.size()), alloc);
+  for (auto& item : v) {
+    Value element;
+    detail::DumpValue(element, alloc, item);
+    array.PushBack(element, alloc);
+  }
+}
+
+// std::vector<bool> hands out proxies rather than bool references.
+template <typename AllocatorType>
+void Dump(rapidjson::Value& array, AllocatorType& alloc, std::vector<bool>& v) {
+  array.SetArray();
+  array.Reserve(static_cast<rapidjson::SizeType>(v.size()), alloc);
+  for (bool item : v) {
+    array.PushBack(rapidjson::Value(item), alloc);
+  }
+}
+
+namespace detail {
+
+template <typename Writer, typename T, typename HasWrite>
+void WriteValue(Writer& w, T& obj, std::true_type, HasWrite) {
+  Primitive<T>::Write(w, obj);
+}
+
+template <typename Writer, typename T>
+void WriteValue(Writer& w, T& obj, std::false_type, std::true_type) {
+  obj.Write(w);
+}
+
+// Types without a Write method are dumped into a DOM and replayed.
+template <typename Writer, typename T>
+void WriteValue(Writer& w, T& obj, std::false_type, std::false_type) {
+  rapidjson::Document doc;
+  obj.Dump(doc, doc.GetAllocator());
+  doc.Accept(w);
+}
+
+}  // namespace detail
+
+template <typename Writer, typename T>
+void Write(Writer& w, T& obj) {
+  detail::WriteValue(w, obj, detail::Primitive<T>(),
+                     detail::HasWrite<T, Writer>());
+}
+
+template <typename Writer>
+void Write(Writer& w, std::string& obj) {
+  w.String(obj.data(), static_cast<rapidjson::SizeType>(obj.size()));
+}
+
+template <typename Writer, typename T>
+void Write(Writer& w, std::vector<T>& v) {
+  w.StartArray();
+  for (auto& item : v) {
+    Write(w, item);
+  }
+  w.EndArray(static_cast<rapidjson::SizeType>(v.size()));
+}
+
+template <typename Writer>
+void Write(Writer& w, std::vector<bool>& v) {
+  w.StartArray();
+  for (bool item : v) {
+    w.Bool(item);
+  }
+  w.EndArray(static_cast<rapidjson::SizeType>(v.size()));
+}
+
+// rapidjson output stream that appends to a std::string, so text is written
+// in place rather than copied out of a StringBuffer.
+class StringSink final {
+ public:
+  typedef char Ch;
+
+  explicit StringSink(std::string& out) : out(out) {}
+
+  void Put(Ch c) { out.push_back(c); }
+  void Flush() {}
+
+ private:
+  std::string& out;
+};
+
+// Immutable snapshot of an Any's JSON, both as a DOM and as compact text.
+// Copies share the snapshot, and any number of threads may dump, write or
+// cast it at once without locking.
+class FrozenAny final {
+ public:
+  FrozenAny() {}
+
+  explicit FrozenAny(const Any& any) {
+    auto snapshot = std::make_shared<Snapshot>();
+    any.Dump(snapshot->value, snapshot->arena);
+    encode(*snapshot);
+    this->snapshot = std::move(snapshot);
+  }
+
+  bool IsNull() const {
+    return snapshot == nullptr || snapshot->value.IsNull();
+  }
+
+  template <typename T>
+  void Cast(T& t) const {
+    if (!TryCast(t)) {
+      throw std::bad_cast();
+    }
+  }
+
+  // Leaves t as it was when the snapshot doesn't bind to a T.
+  template <typename T>
+  bool TryCast(T& t) const {
+    if (IsNull()) {
+      return false;
+    }
+    T value;
+    Status status;
+    if (!detail::TryBindValue(value, snapshot->value, status)) {
+      return false;
+    }
+    t = std::move(value);
+    return true;
+  }
+
+  template <typename AllocatorType>
+  void Dump(rapidjson::Value& v, AllocatorType& alloc) const {
+    if (snapshot == nullptr) {
+      v.SetNull();
+      return;
+    }
+    v.CopyFrom(snapshot->value, alloc);
+  }
+
+  template <typename Writer>
+  void Write(Writer& w) const {
+    if (snapshot == nullptr) {
+      w.Null();
+    } else if (Any::canSplice(w)) {
+      w.RawValue(snapshot->json.data(), snapshot->json.size(),
+                 snapshot->value.GetType());
+    } else {
+      snapshot->value.Accept(w);
+    }
+  }
+
+  void Parse(const rapidjson::Value& v) {
+    auto snapshot = std::make_shared<Snapshot>();
+    snapshot->value.CopyFrom(v, snapshot->arena);
+    encode(*snapshot);
+    this->snapshot = std::move(snapshot);
+  }
+
+ private:
+  struct Snapshot {
+    Snapshot() : arena(Any::kPrivateArenaChunkCapacity) {}
+    Arena arena;
+    rapidjson::Value value;
+    std::string json;
+  };
+
+  static void encode(Snapshot& snapshot) {
+    StringSink sink(snapshot.json);
+    rapidjson::Writer<StringSink> w(sink);
+    snapshot.value.Accept(w);
+  }
+
+  std::shared_ptr<const Snapshot> snapshot;
+};
+
+inline FrozenAny Any::Freeze() const { return FrozenAny(*this); }
+
+// Buffers output for a std::ostream and hands it over a block at a time.
+class OStreamSink final {
+ public:
+  typedef char Ch;
+
+  explicit OStreamSink(std::ostream& out) : out(out), size(0) {}
+
+  ~OStreamSink() { Flush(); }
+
+  OStreamSink(const OStreamSink&) = delete;
+  OStreamSink& operator=(const OStreamSink&) = delete;
+
+  void Put(Ch c) {
+    if (size == sizeof(buffer)) {
+      Flush();
+    }
+    buffer[size++] = c;
+  }
+
+  void Flush() {
+    out.write(buffer, static_cast<std::streamsize>(size));
+    size = 0;
+  }
+
+ private:
+  std::ostream& out;
+  char buffer[4096];
+  size_t size;
+};
+
+#if JSON_ANY_HAS_MMAP
+// Collects a message in fixed-size blocks and sends it to fd with one
+// writev when the writer flushes, without ever copying it into a single
+// buffer. Blocks are kept for the next message, so a sink reused for a
+// stream of messages stops allocating once it has seen the largest one.
+// A failed write throws std::system_error carrying its errno.
+class FdSink final {
+ public:
+  typedef char Ch;
+
+  explicit FdSink(int fd) : fd(fd), used(0), size(0) {}
+
+  FdSink(const FdSink&) = delete;
+  FdSink& operator=(const FdSink&) = delete;
+
+  void Put(Ch c) {
+    if (size == kBlockSize) {
+      if (++used == blocks.size()) {
+        blocks.emplace_back(new char[kBlockSize]);
+      }
+      size = 0;
+    } else if (blocks.empty()) {
+      blocks.emplace_back(new char[kBlockSize]);
+    }
+    blocks[used][size++] = c;
+  }
+
+  void Flush() {
+    if (blocks.empty()) {
+      return;
+    }
+    std::vector<struct iovec> iov(used + 1);
+    for (size_t i = 0; i <= used; i++) {
+      iov[i].iov_base = blocks[i].get();
+      iov[i].iov_len = i < used ? static_cast<size_t>(kBlockSize) : size;
+    }
+    size_t first = 0;
+    while (true) {
+      while (first < iov.size() && iov[first].iov_len == 0) {
+        first++;
+      }
+      if (first == iov.size()) {
+        break;
+      }
+      int count =
+          static_cast<int>(std::min<size_t>(iov.size() - first, IOV_MAX));
+      ssize_t n = writev(fd, &iov[first], count);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        // Nothing written of a non-empty iov would only loop forever.
+        throw std::system_error(n < 0 ? errno : EIO, std::generic_category(),
+                                "Cannot write to fd " + std::to_string(fd));
+      }
+      size_t written = static_cast<size_t>(n);
+      while (first < iov.size() && written >= iov[first].iov_len) {
+        written -= iov[first].iov_len;
+        first++;
+      }
+      if (written > 0) {
+        iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + written;
+        iov[first].iov_len -= written;
+      }
+    }
+    used = 0;
+    size = 0;
+  }
+
+ private:
+  enum { kBlockSize = 64 * 1024 };
+
+  int fd;
+  std::vector<std::unique_ptr<char[]>> blocks;
+  size_t used;
+  size_t size;
+};
+#endif  // JSON_ANY_HAS_MMAP
+
+template <typename T, typename Writer>
+std::string Dump(T& obj) {
+  JSON_ANY_STATS_TIME(kDump);
+  // Reserved at the size of the last message of the same type on this
+  // thread, which is usually close.
+  static thread_local size_t sizeHint = 0;
+  std::string ret;
+  ret.reserve(sizeHint);
+  StringSink sink(ret);
+  typename detail::RebindWriter<Writer, StringSink>::Type w(sink);
+  Write(w, obj);
+  sizeHint = ret.size();
+  return ret;
+}
+
+template <>
+std::string Dump(std::string& obj) {
+  return obj;
+}
+
+template <>
+std::string Dump(int& obj) {
+  return std::to_string(obj);
+}
+
+template <typename T>
+std::string Dump(T& obj) {
+  return Dump<T, rapidjson::Writer<rapidjson::StringBuffer>>(obj);
+}
+
+template <typename T>
+std::string DumpPretty(T& obj) {
+  return Dump<T, rapidjson::PrettyWriter<rapidjson::StringBuffer>>(obj);
+}
+
+// Writes obj as compact JSON to a caller-owned rapidjson output stream,
+// e.g. a reused rapidjson::StringBuffer or a json::FdSink. Output is
+// appended.
+template <typename T, typename Stream>
+typename std::enable_if<!std::is_base_of<std::ostream, Stream>::value>::type
+DumpTo(T& obj, Stream& out) {
+  JSON_ANY_STATS_TIME(kDump);
+  rapidjson::Writer<Stream> w(out);
+  Write(w, obj);
+  out.Flush();
+}
+
+// Replaces the contents of out, keeping its capacity for the next message.
+template <typename T>
+void DumpTo(T& obj, std::string& out) {
+  out.clear();
+  StringSink sink(out);
+  DumpTo(obj, sink);
+}
+
+template <typename T>
+void DumpTo(T& obj, std::ostream& out) {
+  OStreamSink sink(out);
+  DumpTo(obj, sink);
+}
+
+template <typename T>
+std::vector<T> ParseArray(const rapidjson::Value& value) {
+  std::vector<T> ret;
+  detail::BindValue(ret, value);
+  return ret;
+}
+
+template <typename T>
+typename std::enable_if<detail::HasSaxParse<T>::value>::type Parse(  //
+    T& obj,                                                          //
+    SaxReader& reader                                                //
+) {
+  obj.Parse(reader);
+}
+
+// Primitives are read straight off the current token.
+template <typename T>
+typename std::enable_if<detail::Primitive<T>::value>::type Parse(  //
+    T& obj,                                                        //
+    SaxReader& reader                                              //
+) {
+  if (!reader.Read(obj)) {
+    throw std::invalid_argument("Invalid Type in JSON");
+  }
+}
+
+// Types without a streaming Parse get the current value as a DOM.
+template <typename T>
+typename std::enable_if<!detail::HasSaxParse<T>::value &&
+                        !detail::Primitive<T>::value>::type
+Parse(                 //
+    T& obj,            //
+    SaxReader& reader  //
 ) {
+  rapidjson::Document doc;
+  reader.ReadValue(doc, doc.GetAllocator());
+  detail::BindValue(obj, doc);
+}
+
+template <typename T>
+std::vector<T> ParseArray(SaxReader& reader) {
+  std::vector<T> ret;
+  if (!detail::TryParseValue(ret, reader)) {
+    reader.GetStatus().Throw();
+  }
+  return ret;
+}
+
+// ParseArray into a vector of the caller's, for hand-written Parse methods.
+// Under ParseInto the elements v already holds are bound over in place.
+template <typename T>
+void ParseArrayInto(std::vector<T>& v, const rapidjson::Value& value) {
+  detail::BindValue(v, value);
+}
+
+template <typename T>
+void ParseArrayInto(std::vector<T>& v, SaxReader& reader) {
+  if (!detail::TryParseValue(v, reader)) {
+    reader.GetStatus().Throw();
+  }
+}
+
+// Binds obj over what it already holds: strings keep their buffers and
+// vectors overwrite their elements in place, dropping the rest. Reparsing
+// the same object, e.g. through a SaxReader that is Reset for every
+// message, stops allocating once capacities have grown, except for
+// json::Any members. Other Parse calls start vectors from fresh elements.
+template <typename T>
+void ParseInto(T& obj, const rapidjson::Value& value) {
+  detail::InPlaceScope scope(true);
+  detail::BindValue(obj, value);
+}
+
+template <typename T>
+void ParseInto(T& obj, SaxReader& reader) {
+  detail::InPlaceScope scope(true);
+  if (!detail::TryParseValue(obj, reader)) {
+    reader.GetStatus().Throw();
+  }
+}
+
+namespace detail {
+
+#if JSON_ANY_STATS
+// Builds a Document from SAX events, counting the values on the way.
+class CountingHandler final {
+ public:
+  explicit CountingHandler(rapidjson::Document& doc) : doc(doc), nodes(0) {}
+
+  bool Null() { return value(doc.Null()); }
+  bool Bool(bool b) { return value(doc.Bool(b)); }
+  bool Int(int i) { return value(doc.Int(i)); }
+  bool Uint(unsigned u) { return value(doc.Uint(u)); }
+  bool Int64(int64_t i) { return value(doc.Int64(i)); }
+  bool Uint64(uint64_t u) { return value(doc.Uint64(u)); }
+  bool Double(double d) { return value(doc.Double(d)); }
+  bool RawNumber(const char* s, rapidjson::SizeType length, bool copy) {
+    return value(doc.RawNumber(s, length, copy));
+  }
+  bool String(const char* s, rapidjson::SizeType length, bool copy) {
+    return value(doc.String(s, length, copy));
+  }
+  bool StartObject() { return value(doc.StartObject()); }
+  bool Key(const char* s, rapidjson::SizeType length, bool copy) {
+    return doc.Key(s, length, copy);
+  }
+  bool EndObject(rapidjson::SizeType members) {
+    return doc.EndObject(members);
+  }
+  bool StartArray() { return value(doc.StartArray()); }
+  bool EndArray(rapidjson::SizeType elements) {
+    return doc.EndArray(elements);
+  }
+
+  uint64_t Nodes() const { return nodes; }
+
+ private:
+  bool value(bool ok) {
+    nodes++;
+    return ok;
+  }
+
+  rapidjson::Document& doc;
+  uint64_t nodes;
+};
+#endif  // JSON_ANY_STATS
+
+// Parses stream into doc. With stats on, the values are counted while they
+// are built rather than by walking the finished DOM.
+template <unsigned parseFlags, typename Stream>
+void Tokenize(rapidjson::Document& doc, Stream& stream) {
+  JSON_ANY_STATS_TIME(kTokenize);
+#if JSON_ANY_STATS
+  auto generator = [&stream](rapidjson::Document& d) {
+    CountingHandler handler(d);
+    rapidjson::Reader reader;
+    bool ok = !reader.Parse<parseFlags>(stream, handler).IsError();
+    JSON_ANY_STATS_ADD(domNodes, handler.Nodes());
+    return ok;
+  };
+  doc.Populate(generator);
+#else
+  doc.ParseStream<parseFlags>(stream);
+#endif  // JSON_ANY_STATS
+}
+
+template <typename T>
+void ParseDocument(T& obj, const std::string& json,
+                   std::shared_ptr<Arena> arena, bool lazy, std::true_type) {
+  InPlaceScope scope(false);
+  SaxReader reader(json.data(), json.size(), std::move(arena));
+  reader.SetLazy(lazy);
+  if (!reader.IsObject()) {
+    std::string err = "Invalid JSON: " + json;
+    throw std::invalid_argument(err);
+  }
+  JSON_ANY_STATS_TIME(kBind);
+  obj.Parse(reader);
+}
+
+template <typename T>
+void ParseDocument(T& obj, const std::string& json, std::shared_ptr<Arena>,
+                   bool, std::false_type) {
   using rapidjson::Document;
   using rapidjson::Value;
+  InPlaceScope scope(false);
   Document doc;
-  doc.Parse(json);
+  rapidjson::MemoryStream stream(json.data(), json.size());
+  Tokenize<rapidjson::kParseDefaultFlags>(doc, stream);
+  JSON_ANY_STATS_ADD(bytesParsed, json.size());
   if (!doc.IsObject()) {
     std::string err = "Invalid JSON: " + json;
     throw std::invalid_argument(err);
@@ -315,9 +2754,253 @@ void Parse(                  //
   Value v;
   v.SetObject();
   v.Set(object);
+  JSON_ANY_STATS_TIME(kBind);
   obj.Parse(v);
 }
 
+template <typename T>
+Status TryParseDocument(T& obj, SaxReader& reader) {
+  InPlaceScope scope(false);
+  if (!reader.IsObject()) {
+    reader.Fail(ErrorCode::kTypeMismatch, "Invalid JSON: object expected");
+  } else {
+    JSON_ANY_STATS_TIME(kBind);
+    TryParseValue(obj, reader);
+  }
+  return reader.GetStatus();
+}
+
+}  // namespace detail
+
+template <typename T>
+void Parse(                  //
+    T& obj,                  //
+    const std::string& json  //
+) {
+  detail::ParseDocument(obj, json, nullptr, false, detail::HasSaxParse<T>());
+}
+
+// Binds obj with every captured json::Any allocated from arena, so a whole
+// request lives in one pool that is released with its last Any.
+template <typename T>
+void Parse(                       //
+    T& obj,                       //
+    const std::string& json,      //
+    std::shared_ptr<Arena> arena  //
+) {
+  detail::ParseDocument(obj, json, std::move(arena), false,
+                        detail::HasSaxParse<T>());
+}
+
+// Parse that reports failures instead of throwing them. Types bound through
+// JSON_ANY_FIELDS, or with their own TryParse hook, reject bad input without
+// unwinding; others fall back to catching what their Parse throws.
+template <typename T>
+Status TryParse(       //
+    T& obj,            //
+    const char* json,  //
+    size_t length      //
+) {
+  SaxReader reader(NoThrowTag(), json, length);
+  return detail::TryParseDocument(obj, reader);
+}
+
+template <typename T>
+Status TryParse(             //
+    T& obj,                  //
+    const std::string& json  //
+) {
+  return TryParse(obj, json.data(), json.size());
+}
+
+// Binds only the members projection selects. Skipped values are tokenized
+// but never bound or copied, and parsing stops once every selected member
+// has been read. Members of JSON_ANY_FIELDS types that are not in the
+// document are left as they were instead of being reported missing.
+template <typename T>
+void Parse(                       //
+    T& obj,                       //
+    const std::string& json,      //
+    const Projection& projection  //
+) {
+  detail::InPlaceScope scope(false);
+  SaxReader reader(json.data(), json.size());
+  reader.SetProjection(&projection);
+  if (!reader.IsObject()) {
+    throw std::invalid_argument("Invalid JSON: object expected");
+  }
+  JSON_ANY_STATS_TIME(kBind);
+  json::Parse(obj, reader);
+}
+
+template <typename T>
+Status TryParse(                  //
+    T& obj,                       //
+    const std::string& json,      //
+    const Projection& projection  //
+) {
+  SaxReader reader(NoThrowTag(), json.data(), json.size());
+  reader.SetProjection(&projection);
+  return detail::TryParseDocument(obj, reader);
+}
+
+namespace detail {
+
+template <typename T>
+void ParseInsitu(T& obj, char* json, size_t length, std::true_type) {
+  InPlaceScope scope(false);
+  SaxReader reader(InsituTag(), json, length);
+  if (!reader.IsObject()) {
+    throw std::invalid_argument("Invalid JSON: object expected");
+  }
+  JSON_ANY_STATS_TIME(kBind);
+  obj.Parse(reader);
+}
+
+template <typename T>
+void ParseInsitu(T& obj, char* json, size_t length, std::false_type) {
+  InPlaceScope scope(false);
+  rapidjson::Document doc;
+  InsituMemoryStream stream(json, length);
+  Tokenize<rapidjson::kParseInsituFlag>(doc, stream);
+  JSON_ANY_STATS_ADD(bytesParsed, length);
+  if (!doc.IsObject()) {
+    throw std::invalid_argument("Invalid JSON: object expected");
+  }
+  JSON_ANY_STATS_TIME(kBind);
+  obj.Parse(doc);
+}
+
+template <typename T>
+void ParseBuffer(T& obj, const char* json, size_t length, std::true_type) {
+  InPlaceScope scope(false);
+  SaxReader reader(json, length);
+  if (!reader.IsObject()) {
+    throw std::invalid_argument("Invalid JSON: object expected");
+  }
+  JSON_ANY_STATS_TIME(kBind);
+  obj.Parse(reader);
+}
+
+template <typename T>
+void ParseBuffer(T& obj, const char* json, size_t length, std::false_type) {
+  InPlaceScope scope(false);
+  rapidjson::Document doc;
+  rapidjson::MemoryStream stream(json, length);
+  Tokenize<rapidjson::kParseDefaultFlags>(doc, stream);
+  JSON_ANY_STATS_ADD(bytesParsed, length);
+  if (!doc.IsObject()) {
+    throw std::invalid_argument("Invalid JSON: object expected");
+  }
+  JSON_ANY_STATS_TIME(kBind);
+  obj.Parse(doc);
+}
+
+// Read-only view of a whole file, memory-mapped where the platform allows.
+class MappedFile final {
+ public:
+  explicit MappedFile(const std::string& path) : data(nullptr), size(0) {
+#if JSON_ANY_HAS_MMAP
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::invalid_argument("Cannot open " + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      close(fd);
+      throw std::invalid_argument("Cannot stat " + path);
+    }
+    size = static_cast<size_t>(st.st_size);
+    if (size > 0) {
+      void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p == MAP_FAILED) {
+        close(fd);
+        throw std::invalid_argument("Cannot map " + path);
+      }
+      madvise(p, size, MADV_SEQUENTIAL);
+      data = static_cast<const char*>(p);
+    }
+    close(fd);
+#else
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+      throw std::invalid_argument("Cannot open " + path);
+    }
+    contents.assign(std::istreambuf_iterator<char>(in),
+                    std::istreambuf_iterator<char>());
+    data = contents.data();
+    size = contents.size();
+#endif  // JSON_ANY_HAS_MMAP
+  }
+
+  ~MappedFile() {
+#if JSON_ANY_HAS_MMAP
+    if (data != nullptr) {
+      munmap(const_cast<char*>(data), size);
+    }
+#endif  // JSON_ANY_HAS_MMAP
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const char* Data() const { return data != nullptr ? data : ""; }
+  size_t Size() const { return size; }
+
+ private:
+  const char* data;
+  size_t size;
+#if !JSON_ANY_HAS_MMAP
+  std::string contents;
+#endif  // !JSON_ANY_HAS_MMAP
+};
+
+}  // namespace detail
+
+// Parses json in place, for input that is already in a writable buffer.
+// Bound values own their strings, but the buffer itself is overwritten.
+template <typename T>
+void ParseInsitu(  //
+    T& obj,        //
+    char* json,    //
+    size_t length  //
+) {
+  detail::ParseInsitu(obj, json, length, detail::HasSaxParse<T>());
+}
+
+// Parses a file straight from a read-only memory map, without loading it
+// into a std::string first.
+template <typename T>
+void ParseFile(              //
+    T& obj,                  //
+    const std::string& path  //
+) {
+  detail::MappedFile file(path);
+  detail::ParseBuffer(obj, file.Data(), file.Size(), detail::HasSaxParse<T>());
+}
+
+template <typename T>
+typename std::enable_if<std::is_copy_constructible<T>::value, T>::type
+ParseFile(                   //
+    const std::string& path  //
+) {
+  T ret;
+  ParseFile(ret, path);
+  return ret;
+}
+
+// Like Parse, but json::Any members keep their source text and only decode
+// when cast or dumped to a DOM. Compact output splices the text back as is.
+template <typename T>
+void ParseLazy(                             //
+    T& obj,                                 //
+    const std::string& json,                //
+    std::shared_ptr<Arena> arena = nullptr  //
+) {
+  detail::ParseDocument(obj, json, std::move(arena), true,
+                        detail::HasSaxParse<T>());
+}
+
 template <>
 void Parse(std::string& obj, const std::string& json) {
   obj = json;
@@ -328,6 +3011,45 @@ void Parse(int& obj, const std::string& json) {
   obj = std::stoi(json);
 }
 
+namespace detail {
+
+template <typename T>
+void ParsePrimitive(T& obj, const std::string& json) {
+  rapidjson::Document doc;
+  doc.Parse(json);
+  if (doc.HasParseError() || !Primitive<T>::Is(doc)) {
+    throw std::invalid_argument("Invalid JSON: " + json);
+  }
+  obj = Primitive<T>::Get(doc);
+}
+
+}  // namespace detail
+
+template <>
+inline void Parse(bool& obj, const std::string& json) {
+  detail::ParsePrimitive(obj, json);
+}
+
+template <>
+inline void Parse(int64_t& obj, const std::string& json) {
+  detail::ParsePrimitive(obj, json);
+}
+
+template <>
+inline void Parse(uint64_t& obj, const std::string& json) {
+  detail::ParsePrimitive(obj, json);
+}
+
+template <>
+inline void Parse(double& obj, const std::string& json) {
+  detail::ParsePrimitive(obj, json);
+}
+
+template <>
+inline void Parse(InternedString& obj, const std::string& json) {
+  detail::ParsePrimitive(obj, json);
+}
+
 template <typename T>
 typename std::enable_if<std::is_copy_constructible<T>::value, T>::type
 Parse(                       //
@@ -338,6 +3060,416 @@ Parse(                       //
   return ret;
 }
 
+namespace detail {
+
+inline bool KeyEquals(const char* s, size_t length, const char* name,
+                      size_t nameLength) {
+  return length == nameLength && memcmp(s, name, length) == 0;
+}
+
+template <typename AllocatorType, typename T>
+void DumpMember(rapidjson::Value& object, AllocatorType& alloc,
+                const char* name, size_t nameLength, T& field) {
+  rapidjson::Value v;
+  DumpValue(v, alloc, field);
+  object.AddMember(rapidjson::StringRef(name, nameLength), v, alloc);
+}
+
+// ParseField binds one member and returns false when its JSON type is
+// wrong, leaving the error message to the caller, or when a nested value
+// has already reported its own error.
+template <typename T>
+bool ParseField(T& field, const rapidjson::Value& v, Status& status,
+                std::false_type) {
+  return v.IsObject() && TryBindValue(field, v, status);
+}
+
+template <typename T>
+bool ParseField(T& field, const rapidjson::Value& v, Status&,
+                std::true_type) {
+  if (!Primitive<T>::Is(v)) {
+    return false;
+  }
+  field = Primitive<T>::Get(v);
+  return true;
+}
+
+template <typename T>
+bool ParseField(T& field, const rapidjson::Value& v, Status& status) {
+  return ParseField(field, v, status, Primitive<T>());
+}
+
+inline bool ParseField(Any& field, const rapidjson::Value& v, Status&) {
+  field.Parse(v);
+  return true;
+}
+
+inline bool ParseField(std::string& field, const rapidjson::Value& v,
+                       Status&) {
+  if (!v.IsString()) {
+    return false;
+  }
+  field.assign(v.GetString(), v.GetStringLength());
+  return true;
+}
+
+template <typename T>
+bool ParseField(std::vector<T>& field, const rapidjson::Value& v,
+                Status& status) {
+  return v.IsArray() && TryBindValue(field, v, status);
+}
+
+template <typename T>
+bool ParseField(T& field, SaxReader& reader, std::false_type) {
+  return reader.IsObject() && TryParseValue(field, reader);
+}
+
+template <typename T>
+bool ParseField(T& field, SaxReader& reader, std::true_type) {
+  return reader.Read(field);
+}
+
+template <typename T>
+bool ParseField(T& field, SaxReader& reader) {
+  return ParseField(field, reader, Primitive<T>());
+}
+
+inline bool ParseField(Any& field, SaxReader& reader) {
+  field.Parse(reader);
+  return !reader.Failed();
+}
+
+inline bool ParseField(std::string& field, SaxReader& reader) {
+  return reader.Read(field);
+}
+
+template <typename T>
+bool ParseField(std::vector<T>& field, SaxReader& reader) {
+  return reader.IsArray() && TryParseValue(field, reader);
+}
+
+inline bool FailField(Status& status, const char* name, size_t length) {
+  if (status.Ok()) {
+    Fail(status, ErrorCode::kTypeMismatch,
+         "Invalid '" + std::string(name, length) + "' in JSON");
+  }
+  PrefixPath(status, name, length);
+  return false;
+}
+
+inline bool FailField(SaxReader& reader, const char* name, size_t length) {
+  if (!reader.Failed()) {
+    reader.Fail(ErrorCode::kTypeMismatch,
+                "Invalid '" + std::string(name, length) + "' in JSON");
+  }
+  reader.PrefixPath(name, length);
+  return false;
+}
+
+inline bool FailMissing(Status& status, const char* name) {
+  Fail(status, ErrorCode::kMissingMember,
+       "No '" + std::string(name) + "' in JSON");
+  PrefixPath(status, name, strlen(name));
+  return false;
+}
+
+inline bool FailMissing(SaxReader& reader, const char* name) {
+  reader.Fail(ErrorCode::kMissingMember,
+              "No '" + std::string(name) + "' in JSON");
+  reader.PrefixPath(name, strlen(name));
+  return false;
+}
+
+}  // namespace detail
+
+}  // namespace JSON_ANY_ABI
 }  // namespace json
 
+#define JSON_ANY_EXPAND(x) x
+#define JSON_ANY_CONCAT(a, b) JSON_ANY_CONCAT_(a, b)
+#define JSON_ANY_CONCAT_(a, b) a##b
+#define JSON_ANY_NARGS(...)                                                  \
+  JSON_ANY_EXPAND(JSON_ANY_NARGS_(__VA_ARGS__,                               \
+      64, 63, 62, 61, 60, 59, 58, 57, 56, 55, 54, 53, 52, 51, 50, 49, 48,    \
+      47, 46, 45, 44, 43, 42, 41, 40, 39, 38, 37, 36, 35, 34, 33, 32, 31,    \
+      30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16, 15, 14,    \
+      13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1))
+#define JSON_ANY_NARGS_(                                                     \
+    _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16,   \
+    _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30,    \
+    _31, _32, _33, _34, _35, _36, _37, _38, _39, _40, _41, _42, _43, _44,    \
+    _45, _46, _47, _48, _49, _50, _51, _52, _53, _54, _55, _56, _57, _58,    \
+    _59, _60, _61, _62, _63, _64, n, ...) n
+
+// JSON_ANY_FOR_EACH(m, a, b, ...) expands to m(0, a) m((0) + 1, b) ...
+#define JSON_ANY_FOR_EACH(m, ...)                                            \
+  JSON_ANY_EXPAND(JSON_ANY_CONCAT(JSON_ANY_FOR_EACH_,                        \
+                                  JSON_ANY_NARGS(__VA_ARGS__))(              \
+      m, 0, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_1(m, i, x) m(i, x)
+#define JSON_ANY_FOR_EACH_2(m, i, x, ...)                                    \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_1(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_3(m, i, x, ...)                                    \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_2(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_4(m, i, x, ...)                                    \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_3(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_5(m, i, x, ...)                                    \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_4(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_6(m, i, x, ...)                                    \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_5(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_7(m, i, x, ...)                                    \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_6(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_8(m, i, x, ...)                                    \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_7(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_9(m, i, x, ...)                                    \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_8(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_10(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_9(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_11(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_10(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_12(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_11(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_13(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_12(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_14(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_13(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_15(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_14(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_16(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_15(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_17(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_16(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_18(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_17(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_19(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_18(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_20(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_19(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_21(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_20(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_22(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_21(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_23(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_22(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_24(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_23(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_25(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_24(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_26(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_25(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_27(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_26(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_28(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_27(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_29(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_28(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_30(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_29(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_31(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_30(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_32(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_31(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_33(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_32(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_34(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_33(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_35(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_34(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_36(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_35(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_37(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_36(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_38(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_37(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_39(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_38(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_40(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_39(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_41(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_40(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_42(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_41(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_43(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_42(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_44(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_43(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_45(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_44(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_46(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_45(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_47(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_46(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_48(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_47(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_49(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_48(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_50(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_49(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_51(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_50(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_52(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_51(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_53(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_52(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_54(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_53(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_55(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_54(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_56(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_55(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_57(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_56(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_58(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_57(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_59(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_58(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_60(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_59(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_61(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_60(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_62(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_61(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_63(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_62(m, (i) + 1, __VA_ARGS__))
+#define JSON_ANY_FOR_EACH_64(m, i, x, ...)                                   \
+  m(i, x) JSON_ANY_EXPAND(JSON_ANY_FOR_EACH_63(m, (i) + 1, __VA_ARGS__))
+
+#define JSON_ANY_DUMP_FIELD(i, field)                                        \
+  ::json::detail::DumpMember(v, alloc, #field, sizeof(#field) - 1,           \
+                             this->field);
+
+#define JSON_ANY_WRITE_FIELD(i, field)                                       \
+  w.Key(#field, sizeof(#field) - 1);                                         \
+  ::json::Write(w, this->field);
+
+#define JSON_ANY_VISIT_FIELD(i, field)                                       \
+  visit(#field, sizeof(#field) - 1, &JsonAnyType::field);
+
+#define JSON_ANY_PARSE_FIELD(i, field)                                       \
+  case ::json::detail::HashKey(#field, sizeof(#field) - 1):                  \
+    if (::json::detail::KeyEquals(key, keyLength, #field,                    \
+                                  sizeof(#field) - 1)) {                     \
+      if (!::json::detail::ParseField(this->field, value, status)) {         \
+        return ::json::detail::FailField(status, #field,                     \
+                                         sizeof(#field) - 1);                \
+      }                                                                      \
+      found |= uint64_t(1) << (i);                                           \
+      continue;                                                              \
+    }                                                                        \
+    break;
+
+#define JSON_ANY_READ_FIELD(i, field)                                        \
+  case ::json::detail::HashKey(#field, sizeof(#field) - 1):                  \
+    if (::json::detail::KeyEquals(key, keyLength, #field,                    \
+                                  sizeof(#field) - 1)) {                     \
+      if (!::json::detail::ParseField(this->field, value)) {                 \
+        return ::json::detail::FailField(value, #field, sizeof(#field) - 1); \
+      }                                                                      \
+      found |= uint64_t(1) << (i);                                           \
+      continue;                                                              \
+    }                                                                        \
+    break;
+
+#define JSON_ANY_CHECK_FIELD(i, field)                                       \
+  if (missing == nullptr && (found & (uint64_t(1) << (i))) == 0) {           \
+    missing = #field;                                                        \
+  }
+
+// Generates Dump, Write, both Parse overloads, their non-throwing TryParse
+// hooks and VisitFields from a list of up to 64 members. Use it inside the
+// struct body:
+//
+//   struct Singer {
+//     std::string type;
+//     int age = 0;
+//     JSON_ANY_FIELDS(Singer, type, age)
+//   };
+//
+// Parsing makes one pass over the members and switches on a hash of each
+// key, so wide objects decode in linear time. Unknown keys are skipped.
+//
+// VisitFields calls visit(name, nameLength, &Type::member) for each member
+// in order, for code that needs to walk a struct without dumping it.
+#define JSON_ANY_FIELDS(Type, ...)                                           \
+  using JsonAnyType = Type;                                                  \
+                                                                             \
+  template <typename Visitor>                                                \
+  static void VisitFields(Visitor&& visit) {                                 \
+    JSON_ANY_FOR_EACH(JSON_ANY_VISIT_FIELD, __VA_ARGS__)                     \
+  }                                                                          \
+                                                                             \
+  template <typename AllocatorType>                                          \
+  void Dump(rapidjson::Value& v, AllocatorType& alloc) {                     \
+    v.SetObject();                                                           \
+    JSON_ANY_FOR_EACH(JSON_ANY_DUMP_FIELD, __VA_ARGS__)                      \
+  }                                                                          \
+                                                                             \
+  template <typename Writer>                                                 \
+  void Write(Writer& w) {                                                    \
+    w.StartObject();                                                         \
+    JSON_ANY_FOR_EACH(JSON_ANY_WRITE_FIELD, __VA_ARGS__)                     \
+    w.EndObject();                                                           \
+  }                                                                          \
+                                                                             \
+  bool TryParse(const rapidjson::Value& v, ::json::Status& status) {         \
+    if (!v.IsObject()) {                                                     \
+      return ::json::detail::Fail(status, ::json::ErrorCode::kTypeMismatch,  \
+                                  "Invalid " #Type " in JSON");              \
+    }                                                                        \
+    uint64_t found = 0;                                                      \
+    for (auto itr = v.MemberBegin(); itr != v.MemberEnd(); ++itr) {          \
+      const char* key = itr->name.GetString();                               \
+      size_t keyLength = itr->name.GetStringLength();                        \
+      const rapidjson::Value& value = itr->value;                            \
+      switch (::json::detail::HashKey(key, keyLength)) {                     \
+        JSON_ANY_FOR_EACH(JSON_ANY_PARSE_FIELD, __VA_ARGS__)                 \
+        default:                                                             \
+          break;                                                             \
+      }                                                                      \
+    }                                                                        \
+    const char* missing = nullptr;                                           \
+    JSON_ANY_FOR_EACH(JSON_ANY_CHECK_FIELD, __VA_ARGS__)                     \
+    return missing == nullptr ||                                             \
+           ::json::detail::FailMissing(status, missing);                     \
+  }                                                                          \
+                                                                             \
+  void Parse(const rapidjson::Value& v) {                                    \
+    ::json::Status status;                                                   \
+    if (!TryParse(v, status)) {                                              \
+      status.Throw();                                                        \
+    }                                                                        \
+  }                                                                          \
+                                                                             \
+  bool TryParse(::json::SaxReader& value) {                                  \
+    uint64_t found = 0;                                                      \
+    if (!value.StartObject()) {                                              \
+      return false;                                                          \
+    }                                                                        \
+    while (value.NextMember()) {                                             \
+      const char* key = value.Key().data();                                  \
+      size_t keyLength = value.Key().size();                                 \
+      switch (::json::detail::HashKey(key, keyLength)) {                     \
+        JSON_ANY_FOR_EACH(JSON_ANY_READ_FIELD, __VA_ARGS__)                  \
+        default:                                                             \
+          break;                                                             \
+      }                                                                      \
+      value.Skip();                                                          \
+    }                                                                        \
+    if (value.Failed()) {                                                    \
+      return false;                                                          \
+    }                                                                        \
+    const char* missing = nullptr;                                           \
+    if (!value.IsProjected()) {                                              \
+      JSON_ANY_FOR_EACH(JSON_ANY_CHECK_FIELD, __VA_ARGS__)                   \
+    }                                                                        \
+    return missing == nullptr ||                                             \
+           ::json::detail::FailMissing(value, missing);                      \
+  }                                                                          \
+                                                                             \
+  void Parse(::json::SaxReader& value) {                                     \
+    if (!TryParse(value)) {                                                  \
+      value.GetStatus().Throw();                                             \
+    }                                                                        \
+  }
+
 #endif  // JSON_ANY_H
\ No newline at end of file
@@ -0,0 +1,371 @@
+/**
+ * @author Huahang Liu
+ * @since 2026-10-16
+ */
+
+#pragma once
+
+#ifndef JSON_BINARY_H
+#define JSON_BINARY_H
+
+#include <json/any.h>
+#include <rapidjson/document.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace json {
+inline namespace JSON_ANY_ABI {
+
+namespace detail {
+
+// Encodes a DOM as MessagePack, always picking the shortest form, so the
+// output matches other conforming encoders byte for byte. Doubles are
+// written as float64, except NaN and infinity, which throw as in JSON.
+class MsgPackWriter final {
+ public:
+  explicit MsgPackWriter(std::string& out) : out(out) {}
+
+  void Write(const rapidjson::Value& v) {
+    switch (v.GetType()) {
+      case rapidjson::kNullType:
+        put(0xc0);
+        break;
+      case rapidjson::kFalseType:
+        put(0xc2);
+        break;
+      case rapidjson::kTrueType:
+        put(0xc3);
+        break;
+      case rapidjson::kStringType:
+        writeString(v.GetString(), v.GetStringLength());
+        break;
+      case rapidjson::kNumberType:
+        writeNumber(v);
+        break;
+      case rapidjson::kArrayType:
+        writeHeader(v.Size(), 0x90, 0xdc);
+        for (auto& element : v.GetArray()) {
+          Write(element);
+        }
+        break;
+      case rapidjson::kObjectType:
+        writeHeader(v.MemberCount(), 0x80, 0xde);
+        for (auto& member : v.GetObject()) {
+          writeString(member.name.GetString(), member.name.GetStringLength());
+          Write(member.value);
+        }
+        break;
+    }
+  }
+
+ private:
+  void put(uint8_t b) { out += static_cast<char>(b); }
+
+  void putBig(uint64_t n, size_t bytes) {
+    for (size_t i = bytes; i > 0; i--) {
+      put(static_cast<uint8_t>(n >> ((i - 1) * 8)));
+    }
+  }
+
+  // Fix-size header for small counts, else the 16 and 32 bit forms that
+  // follow `marker`.
+  void writeHeader(uint32_t n, uint8_t fix, uint8_t marker) {
+    if (n < 16) {
+      put(static_cast<uint8_t>(fix | n));
+    } else if (n <= 0xffff) {
+      put(marker);
+      putBig(n, 2);
+    } else {
+      put(static_cast<uint8_t>(marker + 1));
+      putBig(n, 4);
+    }
+  }
+
+  void writeString(const char* s, uint32_t length) {
+    if (length < 32) {
+      put(static_cast<uint8_t>(0xa0 | length));
+    } else if (length <= 0xff) {
+      put(0xd9);
+      putBig(length, 1);
+    } else if (length <= 0xffff) {
+      put(0xda);
+      putBig(length, 2);
+    } else {
+      put(0xdb);
+      putBig(length, 4);
+    }
+    out.append(s, length);
+  }
+
+  void writeNumber(const rapidjson::Value& v) {
+    if (v.IsUint64()) {
+      writeUint(v.GetUint64());
+    } else if (v.IsInt64()) {
+      writeInt(v.GetInt64());
+    } else {
+      double d = v.GetDouble();
+      if (!std::isfinite(d)) {
+        Primitive<double>::throwNonFinite();
+      }
+      uint64_t bits;
+      memcpy(&bits, &d, sizeof(bits));
+      put(0xcb);
+      putBig(bits, 8);
+    }
+  }
+
+  void writeUint(uint64_t u) {
+    if (u < 0x80) {
+      put(static_cast<uint8_t>(u));
+    } else if (u <= 0xff) {
+      put(0xcc);
+      putBig(u, 1);
+    } else if (u <= 0xffff) {
+      put(0xcd);
+      putBig(u, 2);
+    } else if (u <= 0xffffffff) {
+      put(0xce);
+      putBig(u, 4);
+    } else {
+      put(0xcf);
+      putBig(u, 8);
+    }
+  }
+
+  void writeInt(int64_t i) {
+    if (i >= 0) {
+      writeUint(static_cast<uint64_t>(i));
+    } else if (i >= -32) {
+      put(static_cast<uint8_t>(i));
+    } else if (i >= INT8_MIN) {
+      put(0xd0);
+      putBig(static_cast<uint64_t>(i), 1);
+    } else if (i >= INT16_MIN) {
+      put(0xd1);
+      putBig(static_cast<uint64_t>(i), 2);
+    } else if (i >= INT32_MIN) {
+      put(0xd2);
+      putBig(static_cast<uint64_t>(i), 4);
+    } else {
+      put(0xd3);
+      putBig(static_cast<uint64_t>(i), 8);
+    }
+  }
+
+  std::string& out;
+};
+
+// Decodes MessagePack into a DOM. Map keys must be strings; bin, ext and
+// timestamp values have no JSON form and are rejected.
+class MsgPackReader final {
+ public:
+  MsgPackReader(const char* data, size_t length)
+      : p(reinterpret_cast<const uint8_t*>(data)), end(p + length) {}
+
+  template <typename AllocatorType>
+  void Read(rapidjson::Value& v, AllocatorType& alloc) {
+    read(v, alloc, 0);
+    if (p != end) {
+      throw std::invalid_argument("Invalid MessagePack: trailing bytes");
+    }
+  }
+
+ private:
+  enum { kMaxDepth = 512 };
+
+  uint8_t take() {
+    need(1);
+    return *p++;
+  }
+
+  uint64_t takeBig(size_t bytes) {
+    need(bytes);
+    uint64_t n = 0;
+    for (size_t i = 0; i < bytes; i++) {
+      n = (n << 8) | *p++;
+    }
+    return n;
+  }
+
+  void need(size_t bytes) {
+    if (static_cast<size_t>(end - p) < bytes) {
+      throw std::invalid_argument("Invalid MessagePack: truncated");
+    }
+  }
+
+  template <typename AllocatorType>
+  void read(rapidjson::Value& v, AllocatorType& alloc, size_t depth) {
+    if (depth > kMaxDepth) {
+      throw std::invalid_argument("Invalid MessagePack: nested too deep");
+    }
+    uint8_t b = take();
+    if (b < 0x80) {
+      v.SetUint64(b);
+    } else if (b >= 0xe0) {
+      v.SetInt64(static_cast<int8_t>(b));
+    } else if ((b & 0xf0) == 0x80) {
+      readMap(v, alloc, b & 0x0f, depth);
+    } else if ((b & 0xf0) == 0x90) {
+      readArray(v, alloc, b & 0x0f, depth);
+    } else if ((b & 0xe0) == 0xa0) {
+      readString(v, alloc, b & 0x1f);
+    } else {
+      switch (b) {
+        case 0xc0:
+          v.SetNull();
+          break;
+        case 0xc2:
+          v.SetBool(false);
+          break;
+        case 0xc3:
+          v.SetBool(true);
+          break;
+        case 0xca: {
+          uint32_t bits = static_cast<uint32_t>(takeBig(4));
+          float f;
+          memcpy(&f, &bits, sizeof(f));
+          setDouble(v, f);
+          break;
+        }
+        case 0xcb: {
+          uint64_t bits = takeBig(8);
+          double d;
+          memcpy(&d, &bits, sizeof(d));
+          setDouble(v, d);
+          break;
+        }
+        case 0xcc:
+        case 0xcd:
+        case 0xce:
+        case 0xcf:
+          v.SetUint64(takeBig(size_t(1) << (b - 0xcc)));
+          break;
+        case 0xd0:
+          v.SetInt64(static_cast<int8_t>(takeBig(1)));
+          break;
+        case 0xd1:
+          v.SetInt64(static_cast<int16_t>(takeBig(2)));
+          break;
+        case 0xd2:
+          v.SetInt64(static_cast<int32_t>(takeBig(4)));
+          break;
+        case 0xd3:
+          v.SetInt64(static_cast<int64_t>(takeBig(8)));
+          break;
+        case 0xd9:
+        case 0xda:
+        case 0xdb:
+          readString(v, alloc, takeBig(size_t(1) << (b - 0xd9)));
+          break;
+        case 0xdc:
+        case 0xdd:
+          readArray(v, alloc, takeBig(b == 0xdc ? 2 : 4), depth);
+          break;
+        case 0xde:
+        case 0xdf:
+          readMap(v, alloc, takeBig(b == 0xde ? 2 : 4), depth);
+          break;
+        default:
+          throw std::invalid_argument("Invalid MessagePack: unsupported type");
+      }
+    }
+  }
+
+  // MessagePack can carry NaN and infinity, but the JSON bound from it can't.
+  static void setDouble(rapidjson::Value& v, double d) {
+    if (!std::isfinite(d)) {
+      throw std::invalid_argument("Invalid MessagePack: NaN or infinity");
+    }
+    v.SetDouble(d);
+  }
+
+  template <typename AllocatorType>
+  void readString(rapidjson::Value& v, AllocatorType& alloc, uint64_t length) {
+    need(length);
+    v.SetString(reinterpret_cast<const char*>(p),
+                static_cast<rapidjson::SizeType>(length), alloc);
+    p += length;
+  }
+
+  // Every element takes at least a byte, which bounds what a bad count can
+  // reserve.
+  template <typename AllocatorType>
+  void readArray(rapidjson::Value& v, AllocatorType& alloc, uint64_t n,
+                 size_t depth) {
+    need(n);
+    v.SetArray();
+    v.Reserve(static_cast<rapidjson::SizeType>(n), alloc);
+    for (uint64_t i = 0; i < n; i++) {
+      rapidjson::Value element;
+      read(element, alloc, depth + 1);
+      v.PushBack(element, alloc);
+    }
+  }
+
+  template <typename AllocatorType>
+  void readMap(rapidjson::Value& v, AllocatorType& alloc, uint64_t n,
+               size_t depth) {
+    need(n * 2);
+    v.SetObject();
+    for (uint64_t i = 0; i < n; i++) {
+      rapidjson::Value name;
+      read(name, alloc, depth + 1);
+      if (!name.IsString()) {
+        throw std::invalid_argument("Invalid MessagePack: key is not a string");
+      }
+      rapidjson::Value member;
+      read(member, alloc, depth + 1);
+      v.AddMember(name, member, alloc);
+    }
+  }
+
+  const uint8_t* p;
+  const uint8_t* end;
+};
+
+}  // namespace detail
+
+// Serializes obj as MessagePack through its Dump method, so any type that
+// dumps to JSON, json::Any included, can be sent in binary form.
+template <typename T>
+std::string DumpBinary(T& obj) {
+  rapidjson::Document doc;
+  obj.Dump(doc, doc.GetAllocator());
+  std::string ret;
+  detail::MsgPackWriter(ret).Write(doc);
+  return ret;
+}
+
+// Binds obj from MessagePack through its DOM Parse method. Like json::Parse,
+// the top-level value must be a map.
+template <typename T>
+void ParseBinary(      //
+    T& obj,            //
+    const char* data,  //
+    size_t length      //
+) {
+  detail::InPlaceScope scope(false);
+  rapidjson::Document doc;
+  detail::MsgPackReader(data, length).Read(doc, doc.GetAllocator());
+  if (!doc.IsObject()) {
+    throw std::invalid_argument("Invalid MessagePack: map expected");
+  }
+  obj.Parse(doc);
+}
+
+template <typename T>
+void ParseBinary(               //
+    T& obj,                    //
+    const std::string& binary  //
+) {
+  ParseBinary(obj, binary.data(), binary.size());
+}
+
+}  // namespace JSON_ANY_ABI
+}  // namespace json
+
+#endif  // JSON_BINARY_H
@@ -0,0 +1,474 @@
+/**
+ * @author Huahang Liu
+ * @since 2026-10-16
+ */
+
+#pragma once
+
+#ifndef JSON_NDJSON_H
+#define JSON_NDJSON_H
+
+#include <json/any.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <istream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace json {
+inline namespace JSON_ANY_ABI {
+
+#if JSON_ANY_HAS_MMAP
+namespace detail {
+
+// Minimal read-only streambuf over a file descriptor, with a fixed buffer.
+class FdStreamBuf final : public std::streambuf {
+ public:
+  explicit FdStreamBuf(int fd) : fd(fd) { setg(buffer, buffer, buffer); }
+
+ protected:
+  int_type underflow() override {
+    if (gptr() < egptr()) {
+      return traits_type::to_int_type(*gptr());
+    }
+    ssize_t n;
+    do {
+      n = read(fd, buffer, sizeof(buffer));
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) {
+      return traits_type::eof();
+    }
+    setg(buffer, buffer, buffer + n);
+    return traits_type::to_int_type(*gptr());
+  }
+
+ private:
+  int fd;
+  char buffer[64 * 1024];
+};
+
+}  // namespace detail
+#endif  // JSON_ANY_HAS_MMAP
+
+// Reads newline-delimited JSON, one T per line. The line buffer and the
+// record are reused, so memory stays flat however long the input is. Lines
+// are parsed in situ and blank lines are skipped.
+//
+//   json::NdjsonReader<Person> reader(std::cin);
+//   for (const Person& p : reader) { ... }
+template <typename T>
+class NdjsonReader final {
+ public:
+  explicit NdjsonReader(std::istream& in) : in(&in), lineNumber(0) {}
+
+#if JSON_ANY_HAS_MMAP
+  // Reads from fd, which stays owned by the caller.
+  explicit NdjsonReader(int fd)
+      : fdBuf(new detail::FdStreamBuf(fd)),
+        fdStream(new std::istream(fdBuf.get())),
+        in(fdStream.get()),
+        lineNumber(0) {}
+#endif  // JSON_ANY_HAS_MMAP
+
+  NdjsonReader(const NdjsonReader&) = delete;
+  NdjsonReader& operator=(const NdjsonReader&) = delete;
+
+  // Binds the next record into record. Returns false at the end of input.
+  bool Next(T& record) {
+    while (std::getline(*in, line)) {
+      lineNumber++;
+      if (line.find_first_not_of(" \t\r") == std::string::npos) {
+        continue;
+      }
+      try {
+        ParseInsitu(record, &line[0], line.size());
+      } catch (const std::invalid_argument& e) {
+        throw std::invalid_argument("Line " + std::to_string(lineNumber) +
+                                    ": " + e.what());
+      }
+      return true;
+    }
+    return false;
+  }
+
+  // Number of the line the last record came from, starting at 1.
+  size_t LineNumber() const { return lineNumber; }
+
+  class Iterator {
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    Iterator() : reader(nullptr) {}
+    explicit Iterator(NdjsonReader* reader) : reader(reader) { ++*this; }
+
+    reference operator*() const { return reader->record; }
+    pointer operator->() const { return &reader->record; }
+
+    Iterator& operator++() {
+      if (!reader->Next(reader->record)) {
+        reader = nullptr;
+      }
+      return *this;
+    }
+
+    bool operator==(const Iterator& other) const {
+      return reader == other.reader;
+    }
+    bool operator!=(const Iterator& other) const { return !(*this == other); }
+
+   private:
+    NdjsonReader* reader;
+  };
+
+  // Single pass. Each step overwrites the record the iterator refers to.
+  Iterator begin() { return Iterator(this); }
+  Iterator end() { return Iterator(); }
+
+ private:
+#if JSON_ANY_HAS_MMAP
+  std::unique_ptr<detail::FdStreamBuf> fdBuf;
+  std::unique_ptr<std::istream> fdStream;
+#endif  // JSON_ANY_HAS_MMAP
+  std::istream* in;
+  std::string line;
+  size_t lineNumber;
+  T record;
+};
+
+// Writes one compact JSON document per line. The output buffer and the
+// rapidjson writer are reused across records.
+template <typename T>
+class NdjsonWriter final {
+ public:
+  explicit NdjsonWriter(std::ostream& out) : out(out), writer(buffer) {}
+
+  NdjsonWriter(const NdjsonWriter&) = delete;
+  NdjsonWriter& operator=(const NdjsonWriter&) = delete;
+
+  void Write(T& record) {
+    buffer.Clear();
+    writer.Reset(buffer);
+    json::Write(writer, record);
+    buffer.Put('\n');
+    out.write(buffer.GetString(), buffer.GetSize());
+  }
+
+  void Flush() { out.flush(); }
+
+ private:
+  std::ostream& out;
+  rapidjson::StringBuffer buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> writer;
+};
+
+// Parses NDJSON on several threads. The input is cut into chunks of whole
+// lines, which are spread over per-worker queues; idle workers steal from
+// the back of the others' queues. Each chunk becomes one batch of records
+// handed to the callback. At most a fixed number of chunks are in flight,
+// so reading blocks when the workers fall behind.
+//
+// In ordered mode batches arrive in input order, one callback at a time.
+// In unordered mode each worker calls back as soon as its batch is ready,
+// so the callback must be thread-safe.
+template <typename T>
+class NdjsonPipeline final {
+ public:
+  using Callback = std::function<void(std::vector<T>& batch)>;
+
+  explicit NdjsonPipeline(
+      size_t threads = std::thread::hardware_concurrency(),
+      bool ordered = true)
+      : threads(std::max<size_t>(threads, 1)),
+        ordered(ordered),
+        chunkSize(1 << 20),
+        maxInFlight(0) {}
+
+  // Bytes read per chunk, rounded up to the end of a line.
+  void SetChunkSize(size_t size) { chunkSize = std::max<size_t>(size, 1); }
+
+  // Chunks read but not yet delivered. Defaults to twice the threads.
+  void SetMaxInFlight(size_t chunks) { maxInFlight = chunks; }
+
+  // Returns once every record has been delivered. The first parse or
+  // callback error stops the pipeline and is rethrown here.
+  void Run(std::istream& in, Callback callback) {
+    State state(threads, ordered, std::move(callback),
+                maxInFlight != 0 ? maxInFlight : threads * 2);
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    for (size_t i = 0; i < threads; i++) {
+      workers.emplace_back([&state, i] { state.Work(i); });
+    }
+    try {
+      read(in, state);
+    } catch (...) {
+      state.Fail(std::current_exception());
+    }
+    state.Finish();
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    if (state.error != nullptr) {
+      std::rethrow_exception(state.error);
+    }
+  }
+
+#if JSON_ANY_HAS_MMAP
+  // Reads from fd, which stays owned by the caller.
+  void Run(int fd, Callback callback) {
+    detail::FdStreamBuf buf(fd);
+    std::istream in(&buf);
+    Run(in, std::move(callback));
+  }
+#endif  // JSON_ANY_HAS_MMAP
+
+ private:
+  struct Chunk {
+    size_t sequence;
+    size_t firstLine;
+    std::string text;
+  };
+
+  struct WorkQueue {
+    std::mutex mutex;
+    std::deque<Chunk> chunks;
+  };
+
+  class State {
+   public:
+    State(size_t threads, bool ordered, Callback callback, size_t maxInFlight)
+        : error(nullptr),
+          queues(threads),
+          ordered(ordered),
+          callback(std::move(callback)),
+          maxInFlight(maxInFlight),
+          inFlight(0),
+          queued(0),
+          finished(false),
+          failed(false),
+          nextSequence(0) {}
+
+    // Blocks while too many chunks are in flight. Returns false once the
+    // pipeline has failed.
+    bool Push(Chunk chunk) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        space.wait(lock, [this] { return failed || inFlight < maxInFlight; });
+        if (failed) {
+          return false;
+        }
+        inFlight++;
+      }
+      WorkQueue& queue = queues[chunk.sequence % queues.size()];
+      {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.chunks.push_back(std::move(chunk));
+      }
+      // Counted only once it is in a queue, so a worker woken for it finds
+      // it there instead of scanning empty queues until it lands.
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        queued++;
+      }
+      work.notify_one();
+      return true;
+    }
+
+    void Finish() {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+      }
+      work.notify_all();
+    }
+
+    void Fail(std::exception_ptr e) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (error == nullptr) {
+          error = e;
+        }
+        failed = true;
+      }
+      work.notify_all();
+      space.notify_all();
+    }
+
+    void Work(size_t self) {
+      Chunk chunk;
+      while (take(self, chunk)) {
+        size_t delivered = 1;
+        if (!isFailed()) {
+          try {
+            delivered = deliver(chunk.sequence, parse(chunk));
+          } catch (...) {
+            Fail(std::current_exception());
+          }
+        }
+        if (delivered == 0) {
+          continue;
+        }
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          inFlight -= std::min(delivered, inFlight);
+        }
+        space.notify_all();
+      }
+    }
+
+    std::exception_ptr error;
+
+   private:
+    // Pops from the front of our own queue, else steals from the back of
+    // another one. Returns false when there is no work left.
+    bool take(size_t self, Chunk& chunk) {
+      for (;;) {
+        for (size_t i = 0; i < queues.size(); i++) {
+          WorkQueue& queue = queues[(self + i) % queues.size()];
+          std::lock_guard<std::mutex> lock(queue.mutex);
+          if (queue.chunks.empty()) {
+            continue;
+          }
+          if (i == 0) {
+            chunk = std::move(queue.chunks.front());
+            queue.chunks.pop_front();
+          } else {
+            chunk = std::move(queue.chunks.back());
+            queue.chunks.pop_back();
+          }
+          std::lock_guard<std::mutex> stateLock(mutex);
+          queued--;
+          return true;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        work.wait(lock, [this] { return queued > 0 || finished; });
+        if (queued == 0) {
+          return false;
+        }
+      }
+    }
+
+    bool isFailed() {
+      std::lock_guard<std::mutex> lock(mutex);
+      return failed;
+    }
+
+    static std::vector<T> parse(Chunk& chunk) {
+      std::vector<T> batch;
+      size_t line = chunk.firstLine;
+      char* begin = &chunk.text[0];
+      char* end = begin + chunk.text.size();
+      while (begin < end) {
+        char* eol = std::find(begin, end, '\n');
+        if (std::find_if(begin, eol, [](char c) {
+              return c != ' ' && c != '\t' && c != '\r';
+            }) != eol) {
+          batch.emplace_back();
+          try {
+            ParseInsitu(batch.back(), begin, static_cast<size_t>(eol - begin));
+          } catch (const std::invalid_argument& e) {
+            throw std::invalid_argument("Line " + std::to_string(line) +
+                                        ": " + e.what());
+          }
+        }
+        begin = eol + 1;
+        line++;
+      }
+      return batch;
+    }
+
+    // Returns how many batches reached the callback. Ordered batches stay
+    // in flight until they do, which also bounds the reorder buffer.
+    size_t deliver(size_t sequence, std::vector<T> batch) {
+      if (!ordered) {
+        callback(batch);
+        return 1;
+      }
+      std::lock_guard<std::mutex> lock(deliverMutex);
+      pending.emplace(sequence, std::move(batch));
+      size_t delivered = 0;
+      for (auto itr = pending.begin();
+           itr != pending.end() && itr->first == nextSequence;
+           itr = pending.erase(itr)) {
+        callback(itr->second);
+        nextSequence++;
+        delivered++;
+      }
+      return delivered;
+    }
+
+    std::vector<WorkQueue> queues;
+    bool ordered;
+    Callback callback;
+    size_t maxInFlight;
+    std::mutex mutex;
+    std::condition_variable work;
+    std::condition_variable space;
+    size_t inFlight;
+    size_t queued;
+    bool finished;
+    bool failed;
+    std::mutex deliverMutex;
+    std::map<size_t, std::vector<T>> pending;
+    size_t nextSequence;
+  };
+
+  void read(std::istream& in, State& state) {
+    std::string carry;
+    size_t sequence = 0;
+    size_t line = 1;
+    std::vector<char> block(chunkSize);
+    for (;;) {
+      in.read(block.data(), static_cast<std::streamsize>(block.size()));
+      size_t n = static_cast<size_t>(in.gcount());
+      if (n == 0) {
+        break;
+      }
+      carry.append(block.data(), n);
+      size_t eol = carry.rfind('\n');
+      if (eol == std::string::npos) {
+        continue;
+      }
+      Chunk chunk{sequence++, line, carry.substr(0, eol + 1)};
+      carry.erase(0, eol + 1);
+      line += static_cast<size_t>(
+          std::count(chunk.text.begin(), chunk.text.end(), '\n'));
+      if (!state.Push(std::move(chunk))) {
+        return;
+      }
+    }
+    if (!carry.empty()) {
+      state.Push(Chunk{sequence, line, std::move(carry)});
+    }
+  }
+
+  size_t threads;
+  bool ordered;
+  size_t chunkSize;
+  size_t maxInFlight;
+};
+
+}  // namespace JSON_ANY_ABI
+}  // namespace json
+
+#endif  // JSON_NDJSON_H
@@ -0,0 +1,343 @@
+/**
+ * @author Huahang Liu
+ * @since 2026-10-16
+ */
+
+#pragma once
+
+#ifndef JSON_PARALLEL_H
+#define JSON_PARALLEL_H
+
+#include <json/any.h>
+#include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace json {
+inline namespace JSON_ANY_ABI {
+
+// Fixed set of worker threads draining a FIFO of tasks. Tasks must not wait
+// on other tasks of the same pool.
+class ThreadPool final {
+ public:
+  explicit ThreadPool(size_t threads = std::thread::hardware_concurrency())
+      : stopping(false) {
+    threads = std::max<size_t>(threads, 1);
+    workers.reserve(threads);
+    for (size_t i = 0; i < threads; i++) {
+      workers.emplace_back([this] { run(); });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    ready.notify_all();
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  size_t Size() const { return workers.size(); }
+
+  // Runs f on a worker. The future rethrows whatever f throws.
+  template <typename F>
+  std::future<void> Submit(F&& f) {
+    auto task =
+        std::make_shared<std::packaged_task<void()>>(std::forward<F>(f));
+    std::future<void> result = task->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      tasks.emplace_back([task] { (*task)(); });
+    }
+    ready.notify_one();
+    return result;
+  }
+
+ private:
+  void run() {
+    for (;;) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [this] { return stopping || !tasks.empty(); });
+        if (tasks.empty()) {
+          return;
+        }
+        task = std::move(tasks.front());
+        tasks.pop_front();
+      }
+      task();
+    }
+  }
+
+  std::vector<std::thread> workers;
+  std::deque<std::function<void()>> tasks;
+  std::mutex mutex;
+  std::condition_variable ready;
+  bool stopping;
+};
+
+namespace detail {
+
+// Small, since most elements only keep a few Anys in theirs.
+enum { kElementArenaChunkCapacity = 1024 };
+
+// Calls f(begin, end) over consecutive chunks of [0, size) on the pool and
+// waits for all of them. The first failing chunk, in order, is rethrown.
+template <typename F>
+void ForEachChunk(ThreadPool& pool, size_t size, F f) {
+  size_t chunks = std::min(size, pool.Size() * 4);
+  if (chunks <= 1) {
+    f(0, size);
+    return;
+  }
+  std::vector<std::future<void>> futures;
+  futures.reserve(chunks);
+  for (size_t i = 0; i < chunks; i++) {
+    size_t begin = size * i / chunks;
+    size_t end = size * (i + 1) / chunks;
+    futures.push_back(pool.Submit([&f, begin, end] { f(begin, end); }));
+  }
+  std::exception_ptr error;
+  for (auto& future : futures) {
+    try {
+      future.get();
+    } catch (...) {
+      if (error == nullptr) {
+        error = std::current_exception();
+      }
+    }
+  }
+  if (error != nullptr) {
+    std::rethrow_exception(error);
+  }
+}
+
+// Splits a top-level JSON array into the text of its elements. This only
+// looks for brackets, quotes and commas, which is far cheaper than
+// tokenizing; each element is validated when it is parsed.
+inline void SplitArray(const std::string& json,
+                       std::vector<std::pair<const char*, size_t>>& slices) {
+  auto isSpace = [](char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+  };
+  const char* p = json.data();
+  const char* end = p + json.size();
+  while (p < end && isSpace(*p)) {
+    p++;
+  }
+  while (end > p && isSpace(end[-1])) {
+    end--;
+  }
+  if (end - p < 2 || *p != '[' || end[-1] != ']') {
+    throw std::invalid_argument("Invalid JSON: array expected");
+  }
+  end--;
+  const char* begin = ++p;
+  auto add = [&](const char* first, const char* last) {
+    while (first < last && isSpace(*first)) {
+      first++;
+    }
+    while (last > first && isSpace(last[-1])) {
+      last--;
+    }
+    if (first == last) {
+      throw std::invalid_argument("Invalid JSON: missing array element");
+    }
+    slices.emplace_back(first, static_cast<size_t>(last - first));
+  };
+  int depth = 0;
+  bool inString = false;
+  for (; p < end; p++) {
+    char c = *p;
+    if (inString) {
+      if (c == '\\') {
+        p++;
+      } else if (c == '"') {
+        inString = false;
+      }
+    } else if (c == '"') {
+      inString = true;
+    } else if (c == '[' || c == '{') {
+      depth++;
+    } else if (c == ']' || c == '}') {
+      if (--depth < 0) {
+        throw std::invalid_argument("Invalid JSON: unbalanced array");
+      }
+    } else if (c == ',' && depth == 0) {
+      add(begin, p);
+      begin = p + 1;
+    }
+  }
+  if (inString || depth != 0) {
+    throw std::invalid_argument("Invalid JSON: unbalanced array");
+  }
+  if (slices.empty() && std::all_of(begin, end, isSpace)) {
+    return;
+  }
+  add(begin, end);
+}
+
+}  // namespace detail
+
+// Parallel ParseArray. Elements are bound in chunks on the pool and keep
+// their order.
+template <typename T>
+std::vector<T> ParseArray(const rapidjson::Value& value, ThreadPool& pool) {
+  if (!value.IsArray()) {
+    throw std::invalid_argument("invalid value");
+  }
+  std::vector<T> ret(value.Size());
+  detail::ForEachChunk(pool, ret.size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      detail::BindValue(ret[i], value[static_cast<rapidjson::SizeType>(i)]);
+    }
+  });
+  return ret;
+}
+
+// Parses a top-level JSON array. The calling thread only scans the text
+// for where each element starts and ends; tokenizing and binding happen on
+// the pool, straight from the source text. Each element gets its own
+// arena, so the Anys of different elements never share one.
+template <typename T>
+std::vector<T> ParseArray(const std::string& json, ThreadPool& pool) {
+  std::vector<std::pair<const char*, size_t>> slices;
+  detail::SplitArray(json, slices);
+  std::vector<T> ret(slices.size());
+  detail::ForEachChunk(pool, ret.size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      auto arena =
+          std::make_shared<Arena>(detail::kElementArenaChunkCapacity);
+      SaxReader element(slices[i].first, slices[i].second, std::move(arena));
+      Parse(ret[i], element);
+    }
+  });
+  return ret;
+}
+
+// Parallel vector Dump into any allocator. Chunks are dumped into their own
+// documents on the pool, then copied into alloc in order on the calling
+// thread, since allocators are not thread-safe. That copy does not scale,
+// so prefer the overload below, which builds the array in place.
+template <typename T, typename AllocatorType>
+void Dump(rapidjson::Value& array, AllocatorType& alloc, std::vector<T>& v,
+          ThreadPool& pool) {
+  using rapidjson::Value;
+  size_t chunks = std::max<size_t>(std::min(v.size(), pool.Size() * 4), 1);
+  std::vector<rapidjson::Document> docs(chunks);
+  detail::ForEachChunk(pool, chunks, [&](size_t begin, size_t end) {
+    for (size_t c = begin; c < end; c++) {
+      auto& docAlloc = docs[c].GetAllocator();
+      docs[c].SetArray();
+      size_t first = v.size() * c / chunks;
+      size_t last = v.size() * (c + 1) / chunks;
+      for (size_t i = first; i < last; i++) {
+        Value item;
+        detail::DumpValue(item, docAlloc, v[i]);
+        docs[c].PushBack(item, docAlloc);
+      }
+    }
+  });
+  array.SetArray();
+  array.Reserve(static_cast<rapidjson::SizeType>(v.size()), alloc);
+  for (auto& doc : docs) {
+    for (auto& item : doc.GetArray()) {
+      Value copy(item, alloc);
+      array.PushBack(copy, alloc);
+    }
+  }
+}
+
+// Parallel vector Dump that builds each element in place. The array itself
+// comes from alloc and the elements of chunk i from arenas[i], so no arena
+// is used by two threads at once. There are as many chunks as arenas, so
+// pass a few per thread of the pool. All of them must outlive the array.
+template <typename T, typename AllocatorType>
+void Dump(rapidjson::Value& array, AllocatorType& alloc,
+          std::vector<std::shared_ptr<Arena>>& arenas, std::vector<T>& v,
+          ThreadPool& pool) {
+  using rapidjson::Value;
+  if (arenas.empty()) {
+    throw std::invalid_argument("No arenas to dump into");
+  }
+  array.SetArray();
+  array.Reserve(static_cast<rapidjson::SizeType>(v.size()), alloc);
+  for (size_t i = 0; i < v.size(); i++) {
+    Value item;
+    array.PushBack(item, alloc);
+  }
+  size_t chunks = std::max<size_t>(std::min(v.size(), arenas.size()), 1);
+  detail::ForEachChunk(pool, chunks, [&](size_t begin, size_t end) {
+    for (size_t c = begin; c < end; c++) {
+      Arena& arena = *arenas[c];
+      size_t first = v.size() * c / chunks;
+      size_t last = v.size() * (c + 1) / chunks;
+      for (size_t i = first; i < last; i++) {
+        auto index = static_cast<rapidjson::SizeType>(i);
+        detail::DumpValue(array[index], arena, v[i]);
+      }
+    }
+  });
+}
+
+// Parallel Dump of a vector to compact JSON, byte for byte the same as
+// Dump(v). Each chunk is written into its own buffer and the buffers are
+// joined in order.
+template <typename T>
+std::string Dump(std::vector<T>& v, ThreadPool& pool) {
+  using rapidjson::StringBuffer;
+  size_t chunks = std::max<size_t>(std::min(v.size(), pool.Size() * 4), 1);
+  std::vector<StringBuffer> buffers(chunks);
+  detail::ForEachChunk(pool, chunks, [&](size_t begin, size_t end) {
+    for (size_t c = begin; c < end; c++) {
+      size_t first = v.size() * c / chunks;
+      size_t last = v.size() * (c + 1) / chunks;
+      rapidjson::Writer<StringBuffer> w(buffers[c]);
+      for (size_t i = first; i < last; i++) {
+        w.Reset(buffers[c]);
+        Write(w, v[i]);
+        if (i + 1 < v.size()) {
+          buffers[c].Put(',');
+        }
+      }
+    }
+  });
+  std::string ret;
+  size_t size = 2;
+  for (auto& buffer : buffers) {
+    size += buffer.GetSize();
+  }
+  ret.reserve(size);
+  ret += '[';
+  for (auto& buffer : buffers) {
+    ret.append(buffer.GetString(), buffer.GetSize());
+  }
+  ret += ']';
+  return ret;
+}
+
+}  // namespace JSON_ANY_ABI
+}  // namespace json
+
+#endif  // JSON_PARALLEL_H
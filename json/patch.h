@@ -0,0 +1,601 @@
+/**
+ * @author Huahang Liu
+ * @since 2026-10-16
+ */
+
+#pragma once
+
+#ifndef JSON_PATCH_H
+#define JSON_PATCH_H
+
+#include <json/any.h>
+#include <rapidjson/document.h>
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace json {
+inline namespace JSON_ANY_ABI {
+
+// One operation of an RFC 6902 JSON Patch. from is used by move and copy,
+// value by add, replace and test.
+struct PatchOperation {
+  std::string op;
+  std::string path;
+  std::string from;
+  Any value;
+
+  bool HasFrom() const { return op == "move" || op == "copy"; }
+  bool HasValue() const {
+    return op == "add" || op == "replace" || op == "test";
+  }
+
+  template <typename AllocatorType>
+  void Dump(rapidjson::Value& v, AllocatorType& alloc) {
+    v.SetObject();
+    v.AddMember("op", rapidjson::Value(op, alloc), alloc);
+    v.AddMember("path", rapidjson::Value(path, alloc), alloc);
+    if (HasFrom()) {
+      v.AddMember("from", rapidjson::Value(from, alloc), alloc);
+    }
+    if (HasValue()) {
+      rapidjson::Value item;
+      value.Dump(item, alloc);
+      v.AddMember("value", item, alloc);
+    }
+  }
+
+  template <typename Writer>
+  void Write(Writer& w) {
+    w.StartObject();
+    w.Key("op");
+    json::Write(w, op);
+    w.Key("path");
+    json::Write(w, path);
+    if (HasFrom()) {
+      w.Key("from");
+      json::Write(w, from);
+    }
+    if (HasValue()) {
+      w.Key("value");
+      json::Write(w, value);
+    }
+    w.EndObject();
+  }
+
+  void Parse(const rapidjson::Value& v) {
+    if (!v.IsObject()) {
+      throw std::invalid_argument("Invalid patch operation in JSON");
+    }
+    auto opValue = v.FindMember("op");
+    if (opValue == v.MemberEnd() || !opValue->value.IsString()) {
+      throw std::invalid_argument("Invalid 'op' in JSON");
+    }
+    op = opValue->value.GetString();
+    auto pathValue = v.FindMember("path");
+    if (pathValue == v.MemberEnd() || !pathValue->value.IsString()) {
+      throw std::invalid_argument("Invalid 'path' in JSON");
+    }
+    path = pathValue->value.GetString();
+    if (HasFrom()) {
+      auto fromValue = v.FindMember("from");
+      if (fromValue == v.MemberEnd() || !fromValue->value.IsString()) {
+        throw std::invalid_argument("Invalid 'from' in JSON");
+      }
+      from = fromValue->value.GetString();
+    }
+    if (HasValue()) {
+      auto valueValue = v.FindMember("value");
+      if (valueValue == v.MemberEnd()) {
+        throw std::invalid_argument("No 'value' in JSON");
+      }
+      value.Parse(valueValue->value);
+    }
+  }
+};
+
+using Patch = std::vector<PatchOperation>;
+
+namespace detail {
+
+template <typename T, typename = void>
+struct HasVisitFields : std::false_type {};
+
+template <typename T>
+struct HasVisitFields<T, decltype(T::VisitFields(std::declval<void (*)(
+                             const char*, size_t, int T::*)>()))>
+    : std::true_type {};
+
+inline void AppendPointer(std::string& path, const char* name,
+                          size_t length) {
+  path += '/';
+  for (size_t i = 0; i < length; i++) {
+    if (name[i] == '~') {
+      path += "~0";
+    } else if (name[i] == '/') {
+      path += "~1";
+    } else {
+      path += name[i];
+    }
+  }
+}
+
+inline void AppendPointer(std::string& path, size_t index) {
+  path += '/';
+  path += std::to_string(index);
+}
+
+// Dump methods aren't const, the generated ones included, but dumping never
+// changes a value, so a Diff of const values may still dump them.
+template <typename T, typename AllocatorType>
+void DumpConst(rapidjson::Value& v, AllocatorType& alloc, const T& obj) {
+  DumpValue(v, alloc, const_cast<T&>(obj));
+}
+
+// Builds the operations of a Diff. Values are dumped into one arena shared
+// by the whole patch.
+class PatchBuilder final {
+ public:
+  explicit PatchBuilder(Patch& patch)
+      : patch(patch), arena(std::make_shared<Arena>()) {}
+
+  std::string& Path() { return path; }
+
+  template <typename T>
+  void Add(const T& value) {
+    setValue(emit("add"), value);
+  }
+
+  template <typename T>
+  void Replace(const T& value) {
+    setValue(emit("replace"), value);
+  }
+
+  void Remove() { emit("remove"); }
+
+ private:
+  PatchOperation& emit(const char* op) {
+    patch.emplace_back();
+    patch.back().op = op;
+    patch.back().path = path;
+    return patch.back();
+  }
+
+  template <typename T>
+  void setValue(PatchOperation& operation, const T& value) {
+    rapidjson::Value v;
+    DumpConst(v, *arena, value);
+    operation.value.Parse(std::move(v), arena);
+  }
+
+  void setValue(PatchOperation& operation, const rapidjson::Value& value) {
+    operation.value.Parse(value, arena);
+  }
+
+  Patch& patch;
+  std::shared_ptr<Arena> arena;
+  std::string path;
+};
+
+// Keeps the builder's path at its length on entry, so each member or
+// element appends its own segment.
+class PathScope final {
+ public:
+  explicit PathScope(std::string& path) : path(path), length(path.size()) {}
+  ~PathScope() { path.resize(length); }
+
+  PathScope(const PathScope&) = delete;
+  PathScope& operator=(const PathScope&) = delete;
+
+ private:
+  std::string& path;
+  size_t length;
+};
+
+inline void DiffJson(PatchBuilder& builder, const rapidjson::Value& a,
+                     const rapidjson::Value& b);
+
+// Arrays are compared element by element. Elements past the end of the
+// shorter one are added, or removed from the back so every index in the
+// patch is valid when it is applied.
+template <typename Diff, typename Add>
+void DiffArray(PatchBuilder& builder, size_t sizeA, size_t sizeB,
+               Diff diffElement, Add addElement) {
+  std::string& path = builder.Path();
+  size_t common = std::min(sizeA, sizeB);
+  for (size_t i = 0; i < common; i++) {
+    PathScope scope(path);
+    AppendPointer(path, i);
+    diffElement(i);
+  }
+  for (size_t i = sizeA; i > sizeB; i--) {
+    PathScope scope(path);
+    AppendPointer(path, i - 1);
+    builder.Remove();
+  }
+  for (size_t i = sizeA; i < sizeB; i++) {
+    PathScope scope(path);
+    AppendPointer(path, i);
+    addElement(i);
+  }
+}
+
+// Objects are matched by member name. Dumps of one type list members in
+// the same order, so each is first looked for at the same position in b,
+// and only otherwise in an index of b's names built on first need.
+inline void DiffObject(PatchBuilder& builder, const rapidjson::Value& a,
+                       const rapidjson::Value& b) {
+  std::string& path = builder.Path();
+  auto members = b.MemberBegin();
+  size_t size = b.MemberCount();
+  std::vector<bool> matched(size);
+  std::unordered_map<std::string, size_t> index;
+  size_t position = 0;
+  for (auto& member : a.GetObject()) {
+    PathScope scope(path);
+    const char* name = member.name.GetString();
+    size_t length = member.name.GetStringLength();
+    AppendPointer(path, name, length);
+    size_t i = position++;
+    if (i >= size || members[i].name != member.name) {
+      if (index.empty()) {
+        for (size_t j = 0; j < size; j++) {
+          index.emplace(std::string(members[j].name.GetString(),
+                                    members[j].name.GetStringLength()),
+                        j);
+        }
+      }
+      auto found = index.find(std::string(name, length));
+      i = found == index.end() ? size : found->second;
+    }
+    if (i == size) {
+      builder.Remove();
+    } else {
+      matched[i] = true;
+      DiffJson(builder, member.value, members[i].value);
+    }
+  }
+  for (size_t i = 0; i < size; i++) {
+    if (!matched[i]) {
+      PathScope scope(path);
+      AppendPointer(path, members[i].name.GetString(),
+                    members[i].name.GetStringLength());
+      builder.Add(members[i].value);
+    }
+  }
+}
+
+inline void DiffJson(PatchBuilder& builder, const rapidjson::Value& a,
+                     const rapidjson::Value& b) {
+  if (a.IsObject() && b.IsObject()) {
+    DiffObject(builder, a, b);
+  } else if (a.IsArray() && b.IsArray()) {
+    DiffArray(
+        builder, a.Size(), b.Size(),
+        [&](size_t i) {
+          auto index = static_cast<rapidjson::SizeType>(i);
+          DiffJson(builder, a[index], b[index]);
+        },
+        [&](size_t i) { builder.Add(b[static_cast<rapidjson::SizeType>(i)]); });
+  } else if (a != b) {
+    builder.Replace(b);
+  }
+}
+
+template <typename T>
+void DiffValue(PatchBuilder& builder, const T& a, const T& b);
+
+template <typename T>
+class FieldDiffer final {
+ public:
+  FieldDiffer(PatchBuilder& builder, const T& a, const T& b)
+      : builder(builder), a(a), b(b) {}
+
+  template <typename Member>
+  void operator()(const char* name, size_t length, Member T::*member) {
+    PathScope scope(builder.Path());
+    AppendPointer(builder.Path(), name, length);
+    DiffValue(builder, a.*member, b.*member);
+  }
+
+ private:
+  PatchBuilder& builder;
+  const T& a;
+  const T& b;
+};
+
+// JSON_ANY_FIELDS types are walked member by member.
+template <typename T>
+void DiffValue(PatchBuilder& builder, const T& a, const T& b, std::true_type,
+               std::false_type) {
+  T::VisitFields(FieldDiffer<T>(builder, a, b));
+}
+
+// Other types are dumped and their DOMs compared.
+template <typename T>
+void DiffValue(PatchBuilder& builder, const T& a, const T& b, std::false_type,
+               std::false_type) {
+  rapidjson::Document docA;
+  rapidjson::Document docB;
+  DumpConst(docA, docA.GetAllocator(), a);
+  DumpConst(docB, docB.GetAllocator(), b);
+  DiffJson(builder, docA, docB);
+}
+
+template <typename T, typename HasFields>
+void DiffValue(PatchBuilder& builder, const T& a, const T& b, HasFields,
+               std::true_type) {
+  if (a != b) {
+    builder.Replace(b);
+  }
+}
+
+template <typename T>
+void DiffValue(PatchBuilder& builder, const T& a, const T& b) {
+  DiffValue(builder, a, b, HasVisitFields<T>(), Primitive<T>());
+}
+
+inline void DiffValue(PatchBuilder& builder, const std::string& a,
+                      const std::string& b) {
+  if (a != b) {
+    builder.Replace(b);
+  }
+}
+
+template <typename T>
+void DiffValue(PatchBuilder& builder, const std::vector<T>& a,
+               const std::vector<T>& b) {
+  DiffArray(
+      builder, a.size(), b.size(),
+      [&](size_t i) { DiffValue(builder, a[i], b[i]); },
+      [&](size_t i) { builder.Add(b[i]); });
+}
+
+// std::vector<bool> hands out proxies, so its elements are copied out.
+inline void DiffValue(PatchBuilder& builder, const std::vector<bool>& a,
+                      const std::vector<bool>& b) {
+  DiffArray(
+      builder, a.size(), b.size(),
+      [&](size_t i) {
+        bool before = a[i];
+        bool after = b[i];
+        DiffValue(builder, before, after);
+      },
+      [&](size_t i) {
+        bool added = b[i];
+        builder.Add(added);
+      });
+}
+
+// Splits a JSON Pointer into unescaped member names and indices.
+inline std::vector<std::string> SplitPointer(const std::string& pointer) {
+  std::vector<std::string> tokens;
+  if (pointer.empty()) {
+    return tokens;
+  }
+  if (pointer[0] != '/') {
+    throw std::invalid_argument("Invalid patch: bad path " + pointer);
+  }
+  size_t pos = 0;
+  while (pos < pointer.size()) {
+    size_t next = pointer.find('/', pos + 1);
+    if (next == std::string::npos) {
+      next = pointer.size();
+    }
+    std::string token;
+    for (size_t i = pos + 1; i < next; i++) {
+      if (pointer[i] == '~' && i + 1 < next &&
+          (pointer[i + 1] == '0' || pointer[i + 1] == '1')) {
+        token += pointer[++i] == '0' ? '~' : '/';
+      } else {
+        token += pointer[i];
+      }
+    }
+    tokens.push_back(std::move(token));
+    pos = next;
+  }
+  return tokens;
+}
+
+// Applies patch operations to a DOM. Every failure throws, naming the path.
+class PatchApplier final {
+ public:
+  PatchApplier(rapidjson::Value& root, Arena& alloc)
+      : root(root), alloc(alloc) {}
+
+  void Apply(const PatchOperation& operation) {
+    const std::string& op = operation.op;
+    if (op == "add") {
+      rapidjson::Value value = valueOf(operation);
+      add(operation.path, value);
+    } else if (op == "remove") {
+      remove(operation.path);
+    } else if (op == "replace") {
+      rapidjson::Value& target = resolve(operation.path);
+      target = valueOf(operation);
+    } else if (op == "move") {
+      rapidjson::Value moved;
+      moved = resolve(operation.from);
+      remove(operation.from);
+      add(operation.path, moved);
+    } else if (op == "copy") {
+      rapidjson::Value copied(resolve(operation.from), alloc);
+      add(operation.path, copied);
+    } else if (op == "test") {
+      rapidjson::Value expected = valueOf(operation);
+      if (resolve(operation.path) != expected) {
+        fail("test failed", operation.path);
+      }
+    } else {
+      fail("unknown op '" + op + "'", operation.path);
+    }
+  }
+
+ private:
+  rapidjson::Value valueOf(const PatchOperation& operation) {
+    rapidjson::Value v;
+    operation.value.Dump(v, alloc);
+    return v;
+  }
+
+  [[noreturn]] static void fail(const std::string& what,
+                                const std::string& path) {
+    throw std::invalid_argument("Invalid patch: " + what + " at '" + path +
+                                "'");
+  }
+
+  static size_t index(const std::string& token, size_t size,
+                      const std::string& path) {
+    if (token.empty() || token.size() > 10 ||
+        token.find_first_not_of("0123456789") != std::string::npos ||
+        (token.size() > 1 && token[0] == '0')) {
+      fail("bad array index", path);
+    }
+    size_t i = std::stoul(token);
+    if (i > size) {
+      fail("index out of range", path);
+    }
+    return i;
+  }
+
+  rapidjson::Value& child(rapidjson::Value& v, const std::string& token,
+                          const std::string& path) {
+    if (v.IsObject()) {
+      auto member = v.FindMember(rapidjson::StringRef(
+          token.data(), static_cast<rapidjson::SizeType>(token.size())));
+      if (member == v.MemberEnd()) {
+        fail("no such member", path);
+      }
+      return member->value;
+    }
+    if (v.IsArray()) {
+      size_t i = index(token, v.Size(), path);
+      if (i == v.Size()) {
+        fail("index out of range", path);
+      }
+      return v[static_cast<rapidjson::SizeType>(i)];
+    }
+    fail("no such value", path);
+  }
+
+  rapidjson::Value& resolve(const std::string& path) {
+    rapidjson::Value* v = &root;
+    for (auto& token : SplitPointer(path)) {
+      v = &child(*v, token, path);
+    }
+    return *v;
+  }
+
+  // The parent of the value path names, and the last token of path.
+  rapidjson::Value& parent(const std::string& path, std::string& last) {
+    std::vector<std::string> tokens = SplitPointer(path);
+    last = std::move(tokens.back());
+    rapidjson::Value* v = &root;
+    for (size_t i = 0; i + 1 < tokens.size(); i++) {
+      v = &child(*v, tokens[i], path);
+    }
+    return *v;
+  }
+
+  void add(const std::string& path, rapidjson::Value& value) {
+    if (path.empty()) {
+      root = value;
+      return;
+    }
+    std::string last;
+    rapidjson::Value& target = parent(path, last);
+    if (target.IsObject()) {
+      rapidjson::Value name(last, alloc);
+      auto member = target.FindMember(name);
+      if (member != target.MemberEnd()) {
+        member->value = value;
+      } else {
+        target.AddMember(name, value, alloc);
+      }
+    } else if (target.IsArray()) {
+      size_t i = last == "-" ? target.Size() : index(last, target.Size(), path);
+      target.PushBack(rapidjson::Value(), alloc);
+      for (size_t j = target.Size() - 1; j > i; j--) {
+        target[static_cast<rapidjson::SizeType>(j)] =
+            target[static_cast<rapidjson::SizeType>(j - 1)];
+      }
+      target[static_cast<rapidjson::SizeType>(i)] = value;
+    } else {
+      fail("no such value", path);
+    }
+  }
+
+  void remove(const std::string& path) {
+    if (path.empty()) {
+      fail("cannot remove the root", path);
+    }
+    std::string last;
+    rapidjson::Value& target = parent(path, last);
+    if (target.IsObject()) {
+      auto member = target.FindMember(rapidjson::StringRef(
+          last.data(), static_cast<rapidjson::SizeType>(last.size())));
+      if (member == target.MemberEnd()) {
+        fail("no such member", path);
+      }
+      target.EraseMember(member);
+    } else if (target.IsArray()) {
+      size_t i = index(last, target.Size(), path);
+      if (i == target.Size()) {
+        fail("index out of range", path);
+      }
+      target.Erase(target.Begin() + i);
+    } else {
+      fail("no such value", path);
+    }
+  }
+
+  rapidjson::Value& root;
+  Arena& alloc;
+};
+
+}  // namespace detail
+
+// RFC 6902 patch turning before into after. JSON_ANY_FIELDS types, vectors,
+// strings and primitives are compared in memory, member by member; other
+// types, json::Any included, are compared through their dumped DOMs. Arrays
+// are diffed by index.
+template <typename T>
+Patch Diff(const T& before, const T& after) {
+  Patch patch;
+  detail::PatchBuilder builder(patch);
+  detail::DiffValue(builder, before, after);
+  return patch;
+}
+
+// Applies patch to obj. The operations are applied to a dump of obj, which
+// is bound into a new T that replaces obj only once binding has succeeded
+// too, so a failing patch leaves obj as it was.
+template <typename T>
+void ApplyPatch(T& obj, const Patch& patch) {
+  rapidjson::Document doc;
+  detail::DumpValue(doc, doc.GetAllocator(), obj);
+  detail::PatchApplier applier(doc, doc.GetAllocator());
+  for (auto& operation : patch) {
+    applier.Apply(operation);
+  }
+  T patched;
+  detail::BindValue(patched, doc);
+  obj = std::move(patched);
+}
+
+// Reads a patch from its JSON text, an array of operations.
+inline Patch ParsePatch(const std::string& json) {
+  SaxReader reader(json.data(), json.size());
+  return ParseArray<PatchOperation>(reader);
+}
+
+}  // namespace JSON_ANY_ABI
+}  // namespace json
+
+#endif  // JSON_PATCH_H
@@ -0,0 +1,151 @@
+/**
+ * @author Huahang Liu
+ * @since 2026-10-16
+ */
+
+#pragma once
+
+#ifndef JSON_STATS_H
+#define JSON_STATS_H
+
+// Build with JSON_ANY_STATS=1 to count and time the work done by json::Parse,
+// json::Dump and json::Any. Otherwise every hook compiles away and the
+// counters stay at zero.
+#ifndef JSON_ANY_STATS
+#define JSON_ANY_STATS 0
+#endif  // JSON_ANY_STATS
+
+// The headers declare everything in an inline namespace named after the
+// setting, so translation units built with and without stats link to
+// separate definitions instead of one silently replacing the other.
+#if JSON_ANY_STATS
+#define JSON_ANY_ABI stats
+#else
+#define JSON_ANY_ABI nostats
+#endif  // JSON_ANY_STATS
+
+#include <stdint.h>
+
+#include <chrono>
+#include <cstddef>
+
+namespace json {
+inline namespace JSON_ANY_ABI {
+
+// Timed phases. Types with a streaming Parse tokenize while they bind, so
+// their whole parse is counted under kBind.
+enum class Phase {
+  kTokenize,      // text to rapidjson DOM
+  kBind,          // T::Parse
+  kJsonToHolder,  // first typed access to a parsed json::Any
+  kCopyOut,       // Cast of a non-assignable type through JSON
+  kDump,          // json::Dump and json::DumpPretty
+  kCount
+};
+
+// Durations of one phase. Bucket i counts calls that took [2^i, 2^(i+1))
+// nanoseconds; bucket 0 also takes anything shorter.
+struct Histogram {
+  enum { kBuckets = 40 };
+
+  uint64_t count = 0;
+  uint64_t totalNanos = 0;
+  uint64_t buckets[kBuckets] = {};
+
+  void Record(uint64_t nanos) {
+    size_t bucket = 0;
+    while (bucket + 1 < kBuckets && (nanos >> (bucket + 1)) != 0) {
+      bucket++;
+    }
+    buckets[bucket]++;
+    count++;
+    totalNanos += nanos;
+  }
+
+  Histogram& operator+=(const Histogram& other) {
+    count += other.count;
+    totalNanos += other.totalNanos;
+    for (size_t i = 0; i < kBuckets; i++) {
+      buckets[i] += other.buckets[i];
+    }
+    return *this;
+  }
+};
+
+struct Stats {
+  uint64_t bytesParsed = 0;        // input handed to a parser
+  uint64_t domNodes = 0;           // rapidjson values built from input
+  uint64_t anyDeepCopies = 0;      // json::Any copies that cloned a holder
+  uint64_t holderAllocations = 0;  // holders and values put on the heap
+  uint64_t castRoundTrips = 0;     // casts done through Dump and Parse
+  Histogram phases[static_cast<size_t>(Phase::kCount)];
+
+  Histogram& operator[](Phase phase) {
+    return phases[static_cast<size_t>(phase)];
+  }
+  const Histogram& operator[](Phase phase) const {
+    return phases[static_cast<size_t>(phase)];
+  }
+
+  // Merges snapshots taken on different threads.
+  Stats& operator+=(const Stats& other) {
+    bytesParsed += other.bytesParsed;
+    domNodes += other.domNodes;
+    anyDeepCopies += other.anyDeepCopies;
+    holderAllocations += other.holderAllocations;
+    castRoundTrips += other.castRoundTrips;
+    for (size_t i = 0; i < static_cast<size_t>(Phase::kCount); i++) {
+      phases[i] += other.phases[i];
+    }
+    return *this;
+  }
+};
+
+namespace detail {
+
+inline Stats& ThreadStats() {
+  static thread_local Stats stats;
+  return stats;
+}
+
+class PhaseTimer final {
+ public:
+  explicit PhaseTimer(Phase phase)
+      : phase(phase), start(std::chrono::steady_clock::now()) {}
+
+  ~PhaseTimer() {
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    ThreadStats()[phase].Record(static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+            .count()));
+  }
+
+  PhaseTimer(const PhaseTimer&) = delete;
+  PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+ private:
+  Phase phase;
+  std::chrono::steady_clock::time_point start;
+};
+
+}  // namespace detail
+
+// Snapshot of the calling thread's counters.
+inline Stats GetStats() { return detail::ThreadStats(); }
+
+inline void ResetStats() { detail::ThreadStats() = Stats(); }
+
+}  // namespace JSON_ANY_ABI
+}  // namespace json
+
+#if JSON_ANY_STATS
+#define JSON_ANY_STATS_ADD(counter, n) \
+  (::json::detail::ThreadStats().counter += (n))
+#define JSON_ANY_STATS_TIME(phase) \
+  ::json::detail::PhaseTimer jsonAnyTimer##phase(::json::Phase::phase)
+#else
+#define JSON_ANY_STATS_ADD(counter, n) ((void)0)
+#define JSON_ANY_STATS_TIME(phase) ((void)0)
+#endif  // JSON_ANY_STATS
+
+#endif  // JSON_STATS_H
@@ -3,10 +3,24 @@
  * @since 2020-08-17
  */
 
+#include <errno.h>
 #include <gtest/gtest.h>
 #include <json/any.h>
+#include <json/binary.h>
+#include <json/ndjson.h>
+#include <json/parallel.h>
+#include <json/patch.h>
+#include <unistd.h>
 
+#include <cstdio>
+#include <fstream>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
 
 #include "test_structs.h"
 
@@ -136,6 +150,1139 @@ TEST(JsonAnyTest, TestAny2) {
   EXPECT_EQ(json, json::Dump(any));
 }
 
+TEST(JsonAnyTest, TestSaxParse) {
+  Singer s = json::Parse<Singer>(
+      "{\"extra\":{\"a\":[1,2,{\"b\":null}]},\"age\":18,\"type\":"
+      "\"rapper\"}");
+  EXPECT_EQ("rapper", s.type);
+  EXPECT_EQ(18, s.age);
+  EXPECT_THROW(json::Parse<Singer>("{\"type\":\"rapper\"}"),
+               std::invalid_argument);
+  EXPECT_THROW(json::Parse<Singer>("{\"type\":1,\"age\":18}"),
+               std::invalid_argument);
+  EXPECT_THROW(json::Parse<Singer>("{\"type\":\"rapper\",\"age\":18"),
+               std::invalid_argument);
+  Friend f = json::Parse<Friend>(
+      "{\"secret\":{\"type\":\"rocker\",\"age\":18},\"relation\":\"x\"}");
+  EXPECT_EQ("x", f.relation);
+  EXPECT_EQ("{\"type\":\"rocker\",\"age\":18}", json::Dump(f.secret));
+  static const char* json = "[{\"name\":\"Ana\"}]";
+  json::SaxReader reader(json, strlen(json));
+  reader.StartArray();
+  ASSERT_TRUE(reader.NextElement());
+  NonCopyable n;
+  json::Parse(n, reader);
+  EXPECT_EQ("Ana", n.name);
+  EXPECT_FALSE(reader.NextElement());
+  EXPECT_TRUE(reader.IsEnd());
+}
+
+template <typename Writer, typename T>
+std::string dumpThroughDom(T& obj) {
+  rapidjson::StringBuffer sb;
+  Writer w(sb);
+  rapidjson::Document doc;
+  obj.Dump(doc, doc.GetAllocator());
+  doc.Accept(w);
+  return sb.GetString();
+}
+
+TEST(JsonAnyTest, TestWrite) {
+  using rapidjson::PrettyWriter;
+  using rapidjson::StringBuffer;
+  using rapidjson::Writer;
+  Singer s1{"rapper", 16};
+  Person p2{"p2", 3, Address{"china", "shanghai", "putuo"}};
+  Address addr1{"china", "beijing", "wangjing", {p2}};
+  Friend f1{"my best friend", Singer{"rocker", 18}};
+  Friend f2{"new friend", "little girl"};
+  Friend f3{"third friend", std::make_shared<Singer>(s1)};
+  Person p1{"p1", 4, addr1, {f1, f2, f3}, "the kind!"};
+  EXPECT_EQ(dumpThroughDom<Writer<StringBuffer>>(p1), json::Dump(p1));
+  EXPECT_EQ(dumpThroughDom<PrettyWriter<StringBuffer>>(p1),
+            json::DumpPretty(p1));
+  json::Any any = p1;
+  EXPECT_EQ(json::Dump(p1), json::Dump(any));
+  EXPECT_EQ(json::DumpPretty(p1), json::DumpPretty(any));
+  std::vector<Singer> singers{s1, s1};
+  EXPECT_EQ("[{\"type\":\"rapper\",\"age\":16},{\"type\":\"rapper\","
+            "\"age\":16}]",
+            json::Dump(singers));
+  NonCopyable n;
+  n.name = "Ana";
+  EXPECT_EQ("{\"name\":\"Ana\"}", json::Dump(n));
+}
+
+TEST(JsonAnyTest, TestAnyMove) {
+  static_assert(std::is_nothrow_move_constructible<json::Any>::value, "");
+  static_assert(std::is_nothrow_move_assignable<json::Any>::value, "");
+  static_assert(std::is_nothrow_move_constructible<Friend>::value, "");
+  static const char* json = "{\"type\":\"rocker\",\"age\":18}";
+  json::Any parsed;
+  json::Parse(parsed, json);
+  json::Any moved(std::move(parsed));
+  EXPECT_EQ(json, json::Dump(moved));
+  EXPECT_EQ("null", json::Dump(parsed));
+  json::Parse(parsed, json);
+  EXPECT_EQ(json, json::Dump(parsed));
+  json::Any held = Singer{"rocker", 18};
+  json::Any other;
+  other = std::move(held);
+  EXPECT_EQ(json, json::Dump(other));
+  EXPECT_FALSE(held.Is<Singer>());
+  swap(other, held);
+  EXPECT_EQ(json, json::Dump(held));
+  EXPECT_EQ("null", json::Dump(other));
+  held = held;
+  EXPECT_EQ(json, json::Dump(held));
+  std::vector<Friend> friends;
+  for (int i = 0; i < 100; i++) {
+    friends.push_back(Friend{"friend", i});
+  }
+  EXPECT_EQ("{\"relation\":\"friend\",\"secret\":99}",
+            json::Dump(friends.back()));
+}
+
+TEST(JsonAnyTest, TestArena) {
+  static_assert(sizeof(json::Any) < sizeof(rapidjson::Document), "");
+  static const char* json =
+      "{\"name\":\"p1\",\"age\":4,\"address\":{\"country\":\"china\",\"city\":"
+      "\"beijing\",\"street\":\"wangjing\",\"neighbors\":[{\"name\":\"p2\","
+      "\"age\":3,\"address\":{\"country\":\"china\",\"city\":\"shanghai\","
+      "\"street\":\"putuo\",\"neighbors\":[]},\"friends\":[],\"secret\":null}]}"
+      ",\"friends\":[{\"relation\":\"my best "
+      "friend\",\"secret\":{\"type\":\"rocker\",\"age\":18}},{\"relation\":"
+      "\"new friend\",\"secret\":\"little girl\"},{\"relation\":\"third "
+      "friend\",\"secret\":3}],\"secret\":\"the kind!\"}";
+  auto arena = std::make_shared<json::Arena>();
+  Person p1;
+  json::Parse(p1, json, arena);
+  // One reference here plus one per captured secret.
+  EXPECT_EQ(6, arena.use_count());
+  Person p2 = p1;
+  EXPECT_EQ(11, arena.use_count());
+  EXPECT_EQ(json, json::Dump(p2));
+  p1 = Person();
+  p2 = Person();
+  EXPECT_EQ(1, arena.use_count());
+  rapidjson::Value v;
+  v.SetString("moved", *arena);
+  json::Any any;
+  any.Parse(std::move(v), arena);
+  EXPECT_EQ("\"moved\"", json::Dump(any));
+}
+
+TEST(JsonAnyTest, TestAnyInline) {
+  json::Any small = 3;
+  json::Any text = std::string("little girl");
+  json::Any shared = std::make_shared<Singer>(Singer{"rocker", 18});
+  json::Any large = Person{"p2", 3, Address{"china", "shanghai", "putuo"}};
+  std::string largeJson = json::Dump(large);
+  json::Any copied = text;
+  EXPECT_EQ("\"little girl\"", json::Dump(copied));
+  json::Any moved = std::move(copied);
+  EXPECT_EQ("\"little girl\"", json::Dump(moved));
+  EXPECT_EQ("null", json::Dump(copied));
+  swap(small, large);
+  EXPECT_EQ("3", json::Dump(large));
+  EXPECT_EQ(largeJson, json::Dump(small));
+  swap(text, shared);
+  EXPECT_EQ("{\"type\":\"rocker\",\"age\":18}", json::Dump(text));
+  EXPECT_EQ("\"little girl\"", json::Dump(shared));
+  EXPECT_EQ(18, json::AnyCast<Singer>(text).age);
+  std::vector<json::Any> anys(4, json::Any(7));
+  anys.resize(64);
+  EXPECT_EQ("7", json::Dump(anys[3]));
+}
+
+TEST(JsonAnyTest, TestAnyRef) {
+  static const char* json = "{\"type\":\"rocker\",\"age\":18}";
+  json::Any parsed;
+  json::Parse(parsed, json);
+  EXPECT_FALSE(parsed.Is<Singer>());
+  Singer& singer = json::AnyRef<Singer>(parsed);
+  EXPECT_TRUE(parsed.Is<Singer>());
+  EXPECT_FALSE(parsed.Is<Band>());
+  EXPECT_EQ(18, singer.age);
+  singer.age = 19;
+  EXPECT_EQ(19, json::AnyCast<Singer>(parsed).age);
+  EXPECT_EQ(&singer, &parsed.Ref<Singer>());
+  EXPECT_EQ("{\"type\":\"rocker\",\"age\":19}", json::Dump(parsed));
+  // Lazy text and cached encodings are dropped once a T& is handed out.
+  Friend f;
+  json::ParseLazy(f, "{\"relation\":\"x\",\"secret\":{\"type\":\"rocker\","
+                     "\"age\":1,\"extra\":0}}");
+  json::AnyRef<Singer>(f.secret).age = 42;
+  rapidjson::Document doc;
+  f.Dump(doc, doc.GetAllocator());
+  EXPECT_EQ(42, doc["secret"]["age"].GetInt());
+  EXPECT_EQ("{\"relation\":\"x\",\"secret\":{\"type\":\"rocker\",\"age\":42}}",
+            json::Dump(f));
+  f.secret.CacheEncoded(1);
+  json::AnyRef<Singer>(f.secret).age = 43;
+  EXPECT_NE(std::string::npos, json::Dump(f).find("\"age\":43"));
+  auto sp = std::make_shared<Singer>(Singer{"rapper", 16});
+  json::Any shared = sp;
+  EXPECT_EQ(sp.get(), &json::AnyRef<Singer>(shared));
+  Singer copied = json::AnyCast<Singer>(shared);
+  copied.age = 17;
+  EXPECT_EQ(16, sp->age);
+  EXPECT_THROW(json::AnyRef<Band>(shared), std::bad_cast);
+  json::Any empty;
+  EXPECT_THROW(json::AnyRef<Singer>(empty), std::bad_cast);
+}
+
+TEST(JsonAnyTest, TestFields) {
+  static const char* json =
+      "{\"title\":\"live\",\"year\":2020,\"venue\":{\"name\":\"arena\","
+      "\"capacity\":500},\"headliner\":{\"singers\":[{\"type\":\"rocker\","
+      "\"age\":18}]},\"guests\":[{\"type\":\"rapper\",\"age\":16}],"
+      "\"sponsor\":{\"brand\":\"x\"}}";
+  doTestOnStruct<Concert>(json);
+  Concert concert = json::Parse<Concert>(json);
+  EXPECT_EQ(dumpThroughDom<rapidjson::Writer<rapidjson::StringBuffer>>(concert),
+            json::Dump(concert));
+  // Out of order members and unknown keys, through both parse paths.
+  static const char* shuffled =
+      "{\"extra\":[1,{\"a\":2}],\"capacity\":7,\"name\":\"club\"}";
+  Venue venue = json::Parse<Venue>(shuffled);
+  EXPECT_EQ("{\"name\":\"club\",\"capacity\":7}", json::Dump(venue));
+  rapidjson::Document doc;
+  doc.Parse(shuffled);
+  Venue domVenue;
+  domVenue.Parse(doc);
+  EXPECT_EQ("club", domVenue.name);
+  EXPECT_EQ(7, domVenue.capacity);
+  json::Any any;
+  json::Parse(any, shuffled);
+  EXPECT_EQ(7, json::AnyCast<Venue>(any).capacity);
+  EXPECT_THROW(json::Parse<Venue>("{\"name\":\"club\"}"),
+               std::invalid_argument);
+  EXPECT_THROW(json::Parse<Venue>("{\"name\":1,\"capacity\":7}"),
+               std::invalid_argument);
+  doc.Parse("{\"name\":\"club\"}");
+  EXPECT_THROW(domVenue.Parse(doc), std::invalid_argument);
+  EXPECT_THROW(json::Parse<Concert>("{\"title\":\"live\",\"year\":1,"
+                                    "\"venue\":[],\"headliner\":{},"
+                                    "\"guests\":[],\"sponsor\":null}"),
+               std::invalid_argument);
+}
+
+TEST(JsonAnyTest, TestLazy) {
+  using rapidjson::StringBuffer;
+  using rapidjson::Writer;
+  static const char* json =
+      "{\"relation\":\"band mate\", \"secret\" : { \"type\" : \"rocker\", "
+      "\"age\" : 18 } }";
+  Friend f;
+  json::ParseLazy(f, json);
+  // The secret is copied through untouched, whitespace included.
+  EXPECT_EQ(
+      "{\"relation\":\"band mate\",\"secret\":{ \"type\" : \"rocker\", "
+      "\"age\" : 18 }}",
+      json::Dump(f));
+  EXPECT_EQ("{\"relation\":\"band mate\",\"secret\":{\"type\":\"rocker\","
+            "\"age\":18}}",
+            dumpThroughDom<Writer<StringBuffer>>(f));
+  Friend eager = json::Parse<Friend>(json);
+  EXPECT_EQ(json::DumpPretty(eager), json::DumpPretty(f));
+  EXPECT_EQ(18, json::AnyCast<Singer>(f.secret).age);
+  EXPECT_THROW(json::AnyCast<Band>(f.secret), std::bad_cast);
+  Friend copied = f;
+  EXPECT_EQ(json::Dump(f), json::Dump(copied));
+  auto arena = std::make_shared<json::Arena>();
+  Person p1;
+  json::ParseLazy(p1,
+                  "{\"name\":\"p1\",\"age\":4,\"address\":{\"country\":"
+                  "\"c\",\"city\":\"c\",\"street\":\"s\",\"neighbors\":[]},"
+                  "\"friends\":[],\"secret\":{\"type\":\"rocker\",\"age\":1}}",
+                  arena);
+  EXPECT_EQ(2, arena.use_count());
+  EXPECT_EQ("rocker", json::AnyCast<Singer>(p1.secret).type);
+  Friend nothing;
+  json::ParseLazy(nothing, "{\"relation\":\"none\",\"secret\":null}");
+  EXPECT_EQ("{\"relation\":\"none\",\"secret\":null}", json::Dump(nothing));
+  EXPECT_THROW(json::AnyCast<Singer>(nothing.secret), std::bad_cast);
+}
+
+TEST(JsonAnyTest, TestInsitu) {
+  std::string json =
+      "{\"relation\":\"tab\\tfriend\",\"secret\":{\"type\":\"say "
+      "\\\"hi\\\"\",\"age\":18}}";
+  // No terminating NUL, and trailing bytes past length are never read.
+  std::vector<char> buffer(json.begin(), json.end());
+  buffer.push_back('x');
+  Friend f;
+  json::ParseInsitu(f, buffer.data(), json.size());
+  EXPECT_EQ("tab\tfriend", f.relation);
+  EXPECT_EQ(json, json::Dump(f));
+  std::string nonCopyable = "{\"name\":\"Ana\"}";
+  NonCopyable n;
+  json::ParseInsitu(n, &nonCopyable[0], nonCopyable.size());
+  EXPECT_EQ("Ana", n.name);
+  std::string truncated = "{\"relation\":";
+  EXPECT_THROW(json::ParseInsitu(f, &truncated[0], truncated.size()),
+               std::invalid_argument);
+}
+
+TEST(JsonAnyTest, TestParseFile) {
+  static const char* json =
+      "{\"relation\":\"pen pal\",\"secret\":[1,2,3]}";
+  std::string path = testing::TempDir() + "jsonany_parse_file.json";
+  std::ofstream(path) << json;
+  Friend f = json::ParseFile<Friend>(path);
+  EXPECT_EQ(json, json::Dump(f));
+  NonCopyable n;
+  std::ofstream(path) << "{\"name\":\"Ana\"}";
+  json::ParseFile(n, path);
+  EXPECT_EQ("Ana", n.name);
+  std::ofstream(path, std::ios::trunc).flush();
+  EXPECT_THROW(json::ParseFile<Friend>(path), std::invalid_argument);
+  std::remove(path.c_str());
+  EXPECT_THROW(json::ParseFile<Friend>(path), std::invalid_argument);
+}
+
+TEST(JsonAnyTest, TestNdjson) {
+  std::stringstream stream;
+  json::NdjsonWriter<Friend> writer(stream);
+  for (int i = 0; i < 1000; i++) {
+    Friend f{"friend " + std::to_string(i), i};
+    writer.Write(f);
+  }
+  writer.Flush();
+  std::string lines = stream.str();
+  EXPECT_EQ("{\"relation\":\"friend 0\",\"secret\":0}\n",
+            lines.substr(0, lines.find('\n') + 1));
+  json::NdjsonReader<Friend> reader(stream);
+  int count = 0;
+  for (const Friend& f : reader) {
+    EXPECT_EQ("friend " + std::to_string(count), f.relation);
+    count++;
+  }
+  EXPECT_EQ(1000, count);
+  std::stringstream bad("{\"relation\":\"a\",\"secret\":1}\n\n  \n{\"oops\"\n");
+  json::NdjsonReader<Friend> badReader(bad);
+  Friend f;
+  EXPECT_TRUE(badReader.Next(f));
+  try {
+    badReader.Next(f);
+    FAIL();
+  } catch (const std::invalid_argument& e) {
+    EXPECT_EQ(0, std::string(e.what()).find("Line 4: "));
+  }
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  std::string first = lines.substr(0, lines.find('\n') + 1);
+  ASSERT_EQ(static_cast<ssize_t>(first.size()),
+            write(fds[1], first.data(), first.size()));
+  close(fds[1]);
+  json::NdjsonReader<Friend> fdReader(fds[0]);
+  EXPECT_TRUE(fdReader.Next(f));
+  EXPECT_EQ("friend 0", f.relation);
+  EXPECT_FALSE(fdReader.Next(f));
+  close(fds[0]);
+}
+
+TEST(JsonAnyTest, TestParallel) {
+  json::ThreadPool pool(4);
+  std::vector<Friend> friends;
+  for (int i = 0; i < 5000; i++) {
+    if (i % 2 == 0) {
+      friends.push_back(Friend{"friend", i});
+    } else {
+      friends.push_back(Friend{"singer", Singer{"rocker", i}});
+    }
+  }
+  std::string serial = json::Dump(friends);
+  EXPECT_EQ(serial, json::Dump(friends, pool));
+  std::vector<Friend> parsed = json::ParseArray<Friend>(serial, pool);
+  ASSERT_EQ(friends.size(), parsed.size());
+  EXPECT_EQ(serial, json::Dump(parsed));
+  rapidjson::Document serialDoc;
+  json::Dump(serialDoc, serialDoc.GetAllocator(), friends);
+  rapidjson::Document parallelDoc;
+  json::Dump(parallelDoc, parallelDoc.GetAllocator(), friends, pool);
+  EXPECT_TRUE(serialDoc == parallelDoc);
+  std::vector<std::shared_ptr<json::Arena>> arenas;
+  for (int i = 0; i < 8; i++) {
+    arenas.push_back(std::make_shared<json::Arena>());
+  }
+  rapidjson::Document inPlaceDoc;
+  json::Dump(inPlaceDoc, inPlaceDoc.GetAllocator(), arenas, friends, pool);
+  EXPECT_TRUE(serialDoc == inPlaceDoc);
+  parsed = json::ParseArray<Friend>(parallelDoc, pool);
+  EXPECT_EQ(serial, json::Dump(parsed));
+  std::vector<Friend> empty;
+  EXPECT_EQ("[]", json::Dump(empty, pool));
+  EXPECT_TRUE(json::ParseArray<Friend>("[]", pool).empty());
+  // Brackets and commas in strings don't split elements.
+  parsed = json::ParseArray<Friend>(
+      " [{\"relation\":\"a],\\\"{\",\"secret\":[1,{}]} ,\n{\"relation\":"
+      "\"b\",\"secret\":null}] ",
+      pool);
+  ASSERT_EQ(2u, parsed.size());
+  EXPECT_EQ("a],\"{", parsed[0].relation);
+  EXPECT_THROW(json::ParseArray<Friend>("[{\"relation\":\"a\",\"secret\":1},]",
+                                        pool),
+               std::invalid_argument);
+  EXPECT_THROW(json::ParseArray<Friend>("[\"a]", pool), std::invalid_argument);
+  std::string bad = serial;
+  bad.replace(bad.rfind("relation"), 8, "relativo");
+  EXPECT_THROW(json::ParseArray<Friend>(bad, pool), std::invalid_argument);
+  EXPECT_THROW(json::ParseArray<Friend>("{}", pool), std::invalid_argument);
+}
+
+TEST(JsonAnyTest, TestNdjsonPipeline) {
+  std::stringstream stream;
+  json::NdjsonWriter<Friend> writer(stream);
+  for (int i = 0; i < 5000; i++) {
+    Friend f{"friend " + std::to_string(i), i};
+    writer.Write(f);
+  }
+  writer.Flush();
+  std::string lines = stream.str();
+  json::NdjsonPipeline<Friend> ordered(4);
+  ordered.SetChunkSize(1000);
+  ordered.SetMaxInFlight(3);
+  std::vector<std::string> relations;
+  std::stringstream in(lines);
+  ordered.Run(in, [&](std::vector<Friend>& batch) {
+    for (auto& f : batch) {
+      relations.push_back(f.relation);
+    }
+  });
+  ASSERT_EQ(5000u, relations.size());
+  for (int i = 0; i < 5000; i++) {
+    EXPECT_EQ("friend " + std::to_string(i), relations[i]);
+  }
+  json::NdjsonPipeline<Friend> unordered(4, false);
+  unordered.SetChunkSize(1000);
+  std::mutex mutex;
+  int sum = 0;
+  size_t count = 0;
+  std::stringstream in2(lines + "\n  \n");
+  unordered.Run(in2, [&](std::vector<Friend>& batch) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& f : batch) {
+      sum += std::stoi(f.relation.substr(7));
+    }
+    count += batch.size();
+  });
+  EXPECT_EQ(5000u, count);
+  EXPECT_EQ(4999 * 5000 / 2, sum);
+  std::stringstream bad(lines + "{\"oops\"\n" + lines);
+  try {
+    ordered.Run(bad, [](std::vector<Friend>&) {});
+    FAIL();
+  } catch (const std::invalid_argument& e) {
+    EXPECT_EQ(0u, std::string(e.what()).find("Line 5001: "));
+  }
+  std::stringstream in3(lines);
+  EXPECT_THROW(unordered.Run(in3,
+                             [](std::vector<Friend>&) {
+                               throw std::runtime_error("stop");
+                             }),
+               std::runtime_error);
+}
+
+TEST(JsonAnyTest, TestStats) {
+  json::Histogram histogram;
+  histogram.Record(0);
+  histogram.Record(1000);
+  EXPECT_EQ(2u, histogram.count);
+  EXPECT_EQ(1000u, histogram.totalNanos);
+  EXPECT_EQ(1u, histogram.buckets[0]);
+  EXPECT_EQ(1u, histogram.buckets[9]);
+  static const std::string text =
+      "{\"relation\":\"r\",\"secret\":{\"type\":\"rocker\",\"age\":18}}";
+  json::ResetStats();
+  Friend f;
+  json::Parse(f, text);
+  EXPECT_EQ(18, json::AnyCast<Singer>(f.secret).age);
+  json::Any copy(f.secret);
+  EXPECT_EQ(text, json::Dump(f));
+  json::Stats stats = json::GetStats();
+#if JSON_ANY_STATS
+  EXPECT_EQ(text.size(), stats.bytesParsed);
+  EXPECT_EQ(3u, stats.domNodes);
+  EXPECT_EQ(1u, stats.anyDeepCopies);
+  EXPECT_EQ(1u, stats[json::Phase::kBind].count);
+  EXPECT_EQ(1u, stats[json::Phase::kJsonToHolder].count);
+  EXPECT_EQ(1u, stats[json::Phase::kDump].count);
+  json::Stats total = stats;
+  total += stats;
+  EXPECT_EQ(2 * stats.bytesParsed, total.bytesParsed);
+  EXPECT_EQ(2u, total[json::Phase::kDump].count);
+  json::ResetStats();
+  EXPECT_EQ(0u, json::GetStats().bytesParsed);
+  // Types without a streaming Parse count the DOM they are bound from.
+  NonCopyable named;
+  json::Parse(named, "{\"name\":\"n\",\"tags\":[1,2]}");
+  EXPECT_EQ(5u, json::GetStats().domNodes);
+  EXPECT_EQ(1u, json::GetStats()[json::Phase::kTokenize].count);
+#else
+  EXPECT_EQ(0u, stats.bytesParsed);
+  EXPECT_EQ(0u, stats[json::Phase::kBind].count);
+#endif  // JSON_ANY_STATS
+}
+
+TEST(JsonAnyTest, TestBinary) {
+  Singer singer{"rapper", 18};
+  EXPECT_EQ(std::string("\x82\xa4type\xa6rapper\xa3" "age\x12"),
+            json::DumpBinary(singer));
+  static const char* json =
+      "{\"name\":\"p1\",\"age\":4,\"address\":{\"country\":\"china\",\"city\":"
+      "\"beijing\",\"street\":\"wangjing\",\"neighbors\":[]},\"friends\":[{"
+      "\"relation\":\"best\",\"secret\":{\"type\":\"rocker\",\"age\":18}},{"
+      "\"relation\":\"new\",\"secret\":\"little girl\"}],\"secret\":3}";
+  Person person;
+  json::Parse(person, json);
+  std::string binary = json::DumpBinary(person);
+  Person decoded;
+  json::ParseBinary(decoded, binary);
+  EXPECT_EQ(json, json::Dump(decoded));
+  EXPECT_EQ(18, json::AnyCast<Singer>(decoded.friends[0].secret).age);
+  std::string numbers(
+      "\x84\xa1" "a\xcf\xff\xff\xff\xff\xff\xff\xff\xff\xa1" "b\xff\xa1"
+      "c\xd1\xfe\xd4\xa1" "d\xcb\x3f\xf8\x00\x00\x00\x00\x00\x00",
+      31);
+  json::Any any;
+  json::ParseBinary(any, numbers);
+  EXPECT_EQ("{\"a\":18446744073709551615,\"b\":-1,\"c\":-300,\"d\":1.5}",
+            json::Dump(any));
+  EXPECT_EQ(numbers, json::DumpBinary(any));
+  EXPECT_THROW(json::ParseBinary(decoded, binary.substr(0, 10)),
+               std::invalid_argument);
+  EXPECT_THROW(json::ParseBinary(any, std::string("\x92\x01\x02")),
+               std::invalid_argument);
+  EXPECT_THROW(json::ParseBinary(any, std::string("\x81\x01\x02")),
+               std::invalid_argument);
+}
+
+TEST(JsonAnyTest, TestDumpTo) {
+  Band band;
+  json::Parse(band,
+              "{\"singers\":[{\"type\":\"rapper\",\"age\":16},{\"type\":"
+              "\"rocker\",\"age\":18}]}");
+  std::string expected = json::Dump(band);
+  std::string out;
+  json::DumpTo(band, out);
+  EXPECT_EQ(expected, out);
+  size_t capacity = out.capacity();
+  Singer singer{"rapper", 18};
+  json::DumpTo(singer, out);
+  EXPECT_EQ(json::Dump(singer), out);
+  EXPECT_EQ(capacity, out.capacity());
+  rapidjson::StringBuffer sb;
+  json::DumpTo(band, sb);
+  EXPECT_EQ(expected, sb.GetString());
+  std::stringstream stream;
+  json::DumpTo(band, stream);
+  EXPECT_EQ(expected, stream.str());
+  std::vector<Friend> friends;
+  for (int i = 0; i < 5000; i++) {
+    friends.push_back(Friend{"friend " + std::to_string(i), i});
+  }
+  std::string path = testing::TempDir() + "jsonany_dump_to.json";
+  std::FILE* file = std::fopen(path.c_str(), "w+");
+  ASSERT_NE(nullptr, file);
+  json::FdSink sink(fileno(file));
+  json::DumpTo(friends, sink);
+  json::DumpTo(band, sink);
+  std::fclose(file);
+  std::ifstream in(path);
+  std::string written((std::istreambuf_iterator<char>(in)),
+                      std::istreambuf_iterator<char>());
+  EXPECT_EQ(json::Dump(friends) + expected, written);
+  std::remove(path.c_str());
+  json::FdSink closed(-1);
+  try {
+    json::DumpTo(band, closed);
+    ADD_FAILURE() << "writing to a bad fd succeeded";
+  } catch (const std::system_error& e) {
+    EXPECT_EQ(EBADF, e.code().value());
+  }
+}
+
+TEST(JsonAnyTest, TestEncodedCache) {
+  auto singer = std::make_shared<Singer>(Singer{"rapper", 18});
+  Friend f{"cached", singer};
+  f.secret.CacheEncoded(1);
+  static const char* age18 =
+      "{\"relation\":\"cached\",\"secret\":{\"type\":\"rapper\",\"age\":18}}";
+  static const char* age19 =
+      "{\"relation\":\"cached\",\"secret\":{\"type\":\"rapper\",\"age\":19}}";
+  EXPECT_EQ(age18, json::Dump(f));
+  singer->age = 19;
+  f.secret.CacheEncoded(1);
+  EXPECT_EQ(age18, json::Dump(f));
+  f.secret.CacheEncoded(2);
+  EXPECT_EQ(age19, json::Dump(f));
+  json::Any copy(f.secret);
+  EXPECT_EQ(json::Dump(f.secret), json::Dump(copy));
+  rapidjson::Document doc;
+  f.Dump(doc, doc.GetAllocator());
+  EXPECT_EQ(19, doc["secret"]["age"].GetInt());
+  singer->age = 20;
+  f.secret.Invalidate();
+  EXPECT_NE(std::string::npos, json::Dump(f).find("\"age\":20"));
+  EXPECT_NE(std::string::npos, json::DumpPretty(f).find("\"age\": 20"));
+  json::Any parsed;
+  json::Parse(parsed, "{\"a\":[1, 2]}");
+  parsed.CacheEncoded();
+  parsed.Invalidate();
+  EXPECT_EQ("{\"a\":[1,2]}", json::Dump(parsed));
+}
+
+TEST(JsonAnyTest, TestPrimitives) {
+  static const char* json =
+      "{\"id\":-5000000000,\"count\":18446744073709551615,\"ratio\":0.25,"
+      "\"active\":true,\"samples\":[1.5,-2.0,3e-7],\"offsets\":[-1,0,"
+      "9007199254740993],\"flags\":[true,false]}";
+  Telemetry t;
+  json::Parse(t, json);
+  EXPECT_EQ(-5000000000, t.id);
+  EXPECT_EQ(18446744073709551615u, t.count);
+  EXPECT_TRUE(t.active);
+  ASSERT_EQ(3u, t.samples.size());
+  EXPECT_EQ(-2.0, t.samples[1]);
+  EXPECT_EQ(9007199254740993, t.offsets[2]);
+  EXPECT_EQ(json, json::Dump(t));
+  rapidjson::Document doc;
+  doc.Parse(json);
+  Telemetry fromDom;
+  fromDom.Parse(doc);
+  rapidjson::Document dumped;
+  fromDom.Dump(dumped, dumped.GetAllocator());
+  EXPECT_TRUE(doc == dumped);
+  EXPECT_THROW(json::Parse(t, "{\"count\":-1}"), std::invalid_argument);
+  EXPECT_THROW(json::Parse(t, "{\"active\":1}"), std::invalid_argument);
+  json::Any any;
+  json::Parse(any, json);
+  Telemetry cast = json::AnyCast<Telemetry>(any);
+  EXPECT_EQ(json, json::Dump(cast));
+  json::Any samples;
+  rapidjson::Document numbers;
+  numbers.Parse("[0.5,1,2]");
+  samples.Parse(numbers);
+  EXPECT_EQ(std::vector<double>({0.5, 1, 2}),
+            json::AnyCast<std::vector<double>>(samples));
+  json::Any count(uint64_t(7));
+  EXPECT_EQ("7", json::Dump(count));
+  json::Any flag(true);
+  EXPECT_EQ("true", json::Dump(flag));
+  rapidjson::Document text;
+  text.Parse("\"hi\"");
+  json::Any greeting;
+  greeting.Parse(text);
+  EXPECT_EQ("hi", json::AnyCast<std::string>(greeting));
+  int64_t big;
+  json::Parse(big, "-9000000000");
+  EXPECT_EQ(-9000000000, big);
+  double ratio;
+  json::Parse(ratio, "0.125");
+  EXPECT_EQ(0.125, ratio);
+  EXPECT_THROW(json::Parse(ratio, "\"x\""), std::invalid_argument);
+  std::vector<int> ints{1, 2, 3};
+  rapidjson::Document array;
+  json::Dump(array, array.GetAllocator(), ints);
+  EXPECT_EQ(std::vector<int>({1, 2, 3}), json::ParseArray<int>(array));
+  EXPECT_EQ("[1,2,3]", json::Dump(ints));
+  // JSON has no NaN or infinity; every path rejects them.
+  Telemetry bad;
+  bad.samples = {1, std::numeric_limits<double>::quiet_NaN()};
+  EXPECT_THROW(json::Dump(bad), std::invalid_argument);
+  rapidjson::Document badDoc;
+  EXPECT_THROW(bad.Dump(badDoc, badDoc.GetAllocator()), std::invalid_argument);
+  EXPECT_THROW(json::DumpBinary(bad), std::invalid_argument);
+  rapidjson::Document nanDoc;
+  nanDoc.SetObject();
+  nanDoc.AddMember("ratio", std::numeric_limits<double>::quiet_NaN(),
+                   nanDoc.GetAllocator());
+  json::Any nanAny;
+  nanAny.Parse(nanDoc);
+  EXPECT_THROW(json::DumpBinary(nanAny), std::invalid_argument);
+  bad.samples.clear();
+  bad.ratio = std::numeric_limits<double>::infinity();
+  EXPECT_THROW(json::Dump(bad), std::invalid_argument);
+  std::string nan("\x81\xa5ratio\xcb\x7f\xf8\0\0\0\0\0\0", 16);
+  EXPECT_THROW(json::ParseBinary(bad, nan), std::invalid_argument);
+}
+
+TEST(JsonAnyTest, TestTryParse) {
+  static const char* json =
+      "{\"title\":\"live\",\"year\":2020,\"venue\":{\"name\":\"arena\","
+      "\"capacity\":500},\"headliner\":{\"singers\":[]},\"guests\":[],"
+      "\"sponsor\":null}";
+  Concert concert;
+  json::Status status = json::TryParse(concert, json);
+  EXPECT_TRUE(status.Ok());
+  EXPECT_EQ(500, concert.venue.capacity);
+  status = json::TryParse(
+      concert, "{\"title\":\"live\",\"year\":1,\"venue\":{\"name\":\"a\","
+               "\"capacity\":\"big\"}}");
+  EXPECT_FALSE(status);
+  EXPECT_EQ(json::ErrorCode::kTypeMismatch, status.code);
+  EXPECT_EQ("/venue/capacity", status.path);
+  EXPECT_EQ("Invalid 'capacity' in JSON", status.message);
+  status = json::TryParse(concert, "{\"title\":\"live\",\"year\":1}");
+  EXPECT_EQ(json::ErrorCode::kMissingMember, status.code);
+  EXPECT_EQ("/venue", status.path);
+  status = json::TryParse(concert, "{\"title\":\"live\",\"year\":}");
+  EXPECT_EQ(json::ErrorCode::kSyntax, status.code);
+  EXPECT_EQ(23u, status.offset);
+  // Types with a throwing Parse only are caught and keep their message.
+  status = json::TryParse(
+      concert, "{\"title\":\"t\",\"year\":1,\"venue\":{\"name\":\"a\","
+               "\"capacity\":1},\"headliner\":{\"singers\":[]},"
+               "\"guests\":[{\"type\":\"rapper\"}],\"sponsor\":null}");
+  EXPECT_EQ("/guests/0", status.path);
+  EXPECT_EQ("No 'age' in JSON", status.message);
+  Telemetry t;
+  status = json::TryParse(t, "{\"samples\":[1,\"x\"]}");
+  EXPECT_EQ("/samples/1", status.path);
+  EXPECT_EQ("Invalid Type in JSON", status.message);
+  status = json::TryParse(t, "[]");
+  EXPECT_EQ(json::ErrorCode::kTypeMismatch, status.code);
+  // The DOM hook reports the same path.
+  rapidjson::Document doc;
+  doc.Parse("{\"name\":\"a\",\"capacity\":true}");
+  Venue venue;
+  json::Status domStatus;
+  EXPECT_FALSE(venue.TryParse(doc, domStatus));
+  EXPECT_EQ("/capacity", domStatus.path);
+  // Throwing parses go through the same code and keep their messages.
+  try {
+    json::Parse<Venue>("{\"name\":\"club\"}");
+    FAIL();
+  } catch (const std::invalid_argument& e) {
+    EXPECT_STREQ("No 'capacity' in JSON", e.what());
+  }
+  json::Any any;
+  json::Parse(any, "{\"name\":\"club\",\"capacity\":7}");
+  Singer singer;
+  EXPECT_FALSE(any.TryCast(singer));
+  EXPECT_FALSE(any.Is<Singer>());
+  EXPECT_TRUE(any.TryCast(venue));
+  EXPECT_EQ(7, venue.capacity);
+  json::Any lazy;
+  json::ParseLazy(lazy, "{\"name\":1,\"capacity\":7}");
+  EXPECT_FALSE(lazy.TryCast(venue));
+  EXPECT_EQ("{\"name\":1,\"capacity\":7}", json::Dump(lazy));
+}
+
+TEST(JsonAnyTest, TestProjection) {
+  static const char* json =
+      "{\"name\":\"spring\",\"venues\":[{\"name\":\"club\",\"capacity\":7},"
+      "{\"capacity\":9,\"name\":\"hall\",\"extra\":[1]}],\"year\":2020}";
+  Setlist setlist;
+  json::Parse(setlist, json, {"/year"});
+  EXPECT_EQ(2020, setlist.year);
+  EXPECT_TRUE(setlist.name.empty());
+  EXPECT_TRUE(setlist.venues.empty());
+  // "-" selects every element of an array, an index just one.
+  Setlist capacities;
+  json::Parse(capacities, json, {"/venues/-/capacity"});
+  ASSERT_EQ(2u, capacities.venues.size());
+  EXPECT_EQ(9, capacities.venues[1].capacity);
+  EXPECT_TRUE(capacities.venues[1].name.empty());
+  Setlist second;
+  json::Parse(second, json, {"/venues/1/name", "/venues/-/capacity"});
+  ASSERT_EQ(2u, second.venues.size());
+  EXPECT_TRUE(second.venues[0].name.empty());
+  EXPECT_EQ(7, second.venues[0].capacity);
+  EXPECT_EQ("hall", second.venues[1].name);
+  EXPECT_EQ(9, second.venues[1].capacity);
+  Setlist member;
+  json::Parse(member, json, {"/venues/capacity"});
+  ASSERT_EQ(2u, member.venues.size());
+  EXPECT_EQ(0, member.venues[1].capacity);
+  json::Projection all({"/venues"});
+  Setlist venues;
+  json::Parse(venues, json, all);
+  EXPECT_EQ("hall", venues.venues[1].name);
+  // Nothing past the last selected member is parsed.
+  Setlist early;
+  EXPECT_TRUE(
+      json::TryParse(early, "{\"name\":\"a\",\"venues\":[}", {"/name"}));
+  EXPECT_EQ("a", early.name);
+  EXPECT_FALSE(json::TryParse(early, "{\"venues\":[},\"name\":\"a\"}",
+                              {"/name"}));
+  json::Status status =
+      json::TryParse(early, "{\"name\":1,\"year\":2}", {"/name", "/year"});
+  EXPECT_EQ("/name", status.path);
+  // Hand-written parsers see the selected members only, and don't report
+  // the others missing.
+  Singer singer;
+  json::Parse(singer, "{\"type\":\"rapper\",\"age\":18}", {"/type", "/age"});
+  EXPECT_EQ(18, singer.age);
+  Singer older;
+  older.type = "rocker";
+  json::Parse(older, "{\"type\":\"rapper\",\"age\":19}", {"/age"});
+  EXPECT_EQ(19, older.age);
+  EXPECT_EQ("rocker", older.type);
+  Person person;
+  json::Parse(person,
+              "{\"name\":\"p\",\"age\":4,\"address\":{\"country\":\"c\","
+              "\"city\":\"c\",\"street\":\"s\",\"neighbors\":[]},"
+              "\"friends\":[],\"secret\":null}",
+              {"/name", "/age"});
+  EXPECT_EQ("p", person.name);
+  EXPECT_EQ(4, person.age);
+  EXPECT_TRUE(person.address.city.empty());
+  json::Any any;
+  json::Parse(any, json, {"/name"});
+  EXPECT_EQ("{\"name\":\"spring\"}", json::Dump(any));
+  json::Parse(any, json, {"/venues/1/name"});
+  EXPECT_EQ("{\"venues\":[null,{\"name\":\"hall\"}]}", json::Dump(any));
+  EXPECT_THROW(json::Projection({"name"}), std::invalid_argument);
+}
+
+TEST(JsonAnyTest, TestPatch) {
+  static const char* json =
+      "{\"title\":\"live\",\"year\":2020,\"venue\":{\"name\":\"arena\","
+      "\"capacity\":500},\"headliner\":{\"singers\":[{\"type\":\"rocker\","
+      "\"age\":18}]},\"guests\":[{\"type\":\"rapper\",\"age\":16}],"
+      "\"sponsor\":{\"brand\":\"x\",\"tier\":1}}";
+  Concert before = json::Parse<Concert>(json);
+  Concert after = json::Parse<Concert>(json);
+  EXPECT_TRUE(json::Diff(before, after).empty());
+  after.venue.capacity = 600;
+  after.headliner.singers[0].age = 19;
+  after.guests.push_back(Singer{"rocker", 20});
+  json::Parse(after.sponsor, "{\"brand\":\"y/z\"}");
+  const Concert& constBefore = before;
+  const Concert& constAfter = after;
+  json::Patch patch = json::Diff(constBefore, constAfter);
+  EXPECT_EQ(
+      "[{\"op\":\"replace\",\"path\":\"/venue/capacity\",\"value\":600},"
+      "{\"op\":\"replace\",\"path\":\"/headliner/singers/0/age\","
+      "\"value\":19},{\"op\":\"add\",\"path\":\"/guests/1\",\"value\":"
+      "{\"type\":\"rocker\",\"age\":20}},{\"op\":\"replace\",\"path\":"
+      "\"/sponsor/brand\",\"value\":\"y/z\"},{\"op\":\"remove\",\"path\":"
+      "\"/sponsor/tier\"}]",
+      json::Dump(patch));
+  json::ApplyPatch(before, json::ParsePatch(json::Dump(patch)));
+  EXPECT_EQ(json::Dump(after), json::Dump(before));
+  // A patch whose result doesn't bind leaves the object as it was.
+  json::Patch unbindable = json::ParsePatch(
+      "[{\"op\":\"replace\",\"path\":\"/title\",\"value\":\"new\"},"
+      "{\"op\":\"replace\",\"path\":\"/year\",\"value\":\"x\"}]");
+  EXPECT_THROW(json::ApplyPatch(before, unbindable), std::invalid_argument);
+  EXPECT_EQ(json::Dump(after), json::Dump(before));
+  // Members in a different order are still matched by name.
+  json::Any reordered;
+  json::Any original;
+  json::Parse(reordered, "{\"b\":1,\"a\":{\"x\":1},\"c\":3}");
+  json::Parse(original, "{\"a\":{\"x\":2},\"b\":1,\"d\":4}");
+  patch = json::Diff(reordered, original);
+  EXPECT_EQ(
+      "[{\"op\":\"replace\",\"path\":\"/a/x\",\"value\":2},{\"op\":"
+      "\"remove\",\"path\":\"/c\"},{\"op\":\"add\",\"path\":\"/d\","
+      "\"value\":4}]",
+      json::Dump(patch));
+  // Shrinking arrays are trimmed from the back.
+  Telemetry t1;
+  t1.samples = {1, 2, 3};
+  t1.flags = {true, false};
+  Telemetry t2 = t1;
+  t2.samples = {1};
+  t2.flags = {true, true, false};
+  patch = json::Diff(t1, t2);
+  EXPECT_EQ("/samples/2", patch[0].path);
+  EXPECT_EQ("/samples/1", patch[1].path);
+  json::ApplyPatch(t1, patch);
+  EXPECT_EQ(json::Dump(t2), json::Dump(t1));
+  // json::Any payloads are diffed through their JSON.
+  json::Any a;
+  json::Any b;
+  json::Parse(a, "{\"k\":[1,2],\"s\":\"x\"}");
+  json::Parse(b, "{\"k\":[1,3],\"n\":null}");
+  json::ApplyPatch(a, json::Diff(a, b));
+  EXPECT_EQ(json::Dump(b), json::Dump(a));
+  // Every RFC 6902 op applies; a failing one leaves the value untouched.
+  json::ApplyPatch(
+      a, json::ParsePatch("[{\"op\":\"move\",\"from\":\"/k/0\",\"path\":"
+                          "\"/m\"},{\"op\":\"copy\",\"from\":\"/m\",\"path\":"
+                          "\"/k/-\"},{\"op\":\"test\",\"path\":\"/k\","
+                          "\"value\":[3,1]}]"));
+  EXPECT_EQ("{\"k\":[3,1],\"n\":null,\"m\":1}", json::Dump(a));
+  EXPECT_THROW(
+      json::ApplyPatch(a, json::ParsePatch("[{\"op\":\"remove\",\"path\":"
+                                           "\"/n\"},{\"op\":\"test\","
+                                           "\"path\":\"/m\",\"value\":2}]")),
+      std::invalid_argument);
+  EXPECT_EQ("{\"k\":[3,1],\"n\":null,\"m\":1}", json::Dump(a));
+  EXPECT_THROW(json::ApplyPatch(a, json::ParsePatch("[{\"op\":\"remove\","
+                                                    "\"path\":\"/k/2\"}]")),
+               std::invalid_argument);
+}
+
+TEST(JsonAnyTest, TestConcurrentDump) {
+  Concert concert;
+  json::ParseLazy(concert,
+                  "{\"title\":\"live\",\"year\":2020,\"venue\":{\"name\":"
+                  "\"arena\",\"capacity\":500},\"headliner\":{\"singers\":[]},"
+                  "\"guests\":[],\"sponsor\":{\"brand\": \"x\","
+                  "\"tiers\":[1,2]}}");
+  const json::Any lazy = concert.sponsor;
+  auto band = std::make_shared<Band>();
+  band->singers.push_back(Singer{"rocker", 18});
+  const json::Any held(band);
+  const json::Any shared(held);
+  json::Any lazyCopy(lazy);
+  std::string pretty = json::DumpPretty(lazyCopy);
+  std::string compact = json::Dump(held);
+  std::vector<std::string> results(8);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < results.size(); i++) {
+    threads.emplace_back([&, i] {
+      for (int n = 0; n < 100; n++) {
+        rapidjson::Document doc;
+        lazy.Dump(doc, doc.GetAllocator());
+        bool same = json::DumpPretty(lazy) == pretty &&
+                    doc["tiers"].Size() == 2 &&
+                    json::Dump(i % 2 == 0 ? held : shared) == compact;
+        results[i] += same ? "" : "x";
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (auto& result : results) {
+    EXPECT_EQ("", result);
+  }
+  // A frozen snapshot keeps the JSON from the time it was taken.
+  json::FrozenAny frozen = held.Freeze();
+  band->singers[0].age = 19;
+  EXPECT_EQ(compact, json::Dump(frozen));
+  EXPECT_NE(compact, json::Dump(held));
+  const json::FrozenAny copy(frozen);
+  Band thawed;
+  copy.Cast(thawed);
+  EXPECT_EQ(18, thawed.singers[0].age);
+  Singer singer;
+  EXPECT_FALSE(copy.TryCast(singer));
+  EXPECT_THROW(json::FrozenAny().Cast(singer), std::bad_cast);
+  EXPECT_TRUE(json::FrozenAny(json::Any()).IsNull());
+  json::FrozenAny lazyFrozen = lazy.Freeze();
+  EXPECT_EQ("{\"brand\":\"x\",\"tiers\":[1,2]}", json::Dump(lazyFrozen));
+  EXPECT_EQ(pretty, json::DumpPretty(lazyFrozen));
+}
+
+TEST(JsonAnyTest, TestConcurrentCast) {
+  std::string json = "[";
+  for (int i = 0; i < 800; i++) {
+    json += i == 0 ? "{" : ",{";
+    json += "\"relation\":\"r\",\"secret\":{\"relation\":\"nested\","
+            "\"secret\":{\"type\":\"rocker\",\"age\":" +
+            std::to_string(i) + "}}}";
+  }
+  json += "]";
+  // Siblings share one arena. Neither casting them nor caching their
+  // encoding may allocate from it.
+  auto arena = std::make_shared<json::Arena>();
+  json::SaxReader lazyReader(json.data(), json.size(), arena);
+  lazyReader.SetLazy(true);
+  std::vector<Friend> lazy = json::ParseArray<Friend>(lazyReader);
+  json::SaxReader eagerReader(json.data(), json.size(), arena);
+  std::vector<Friend> eager = json::ParseArray<Friend>(eagerReader);
+  std::vector<std::string> results(8);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < results.size(); i++) {
+    threads.emplace_back([&, i] {
+      for (size_t j = i; j < lazy.size(); j += results.size()) {
+        Friend inner = json::AnyCast<Friend>(lazy[j].secret);
+        eager[j].secret.CacheEncoded();
+        int age = json::AnyCast<Singer>(inner.secret).age;
+        bool same = age == static_cast<int>(j) &&
+                    json::Dump(eager[j]) == json::Dump(lazy[j]);
+        results[i] += same ? "" : "x";
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (auto& result : results) {
+    EXPECT_EQ("", result);
+  }
+}
+
+TEST(JsonAnyTest, TestCastKeepsJson) {
+  using rapidjson::StringBuffer;
+  using rapidjson::Writer;
+  static const char* json =
+      "{\"relation\":\"r\",\"secret\":{\"type\":\"rocker\",\"age\":5,"
+      "\"extra\":[1,2]}}";
+  Friend lazy;
+  json::ParseLazy(lazy, json);
+  Friend eager = json::Parse<Friend>(json);
+  // Members Singer doesn't model survive the cast, lazy or not.
+  EXPECT_EQ(5, json::AnyCast<Singer>(lazy.secret).age);
+  EXPECT_EQ(5, json::AnyCast<Singer>(eager.secret).age);
+  EXPECT_EQ(json, json::Dump(lazy));
+  EXPECT_EQ(json, json::Dump(eager));
+  EXPECT_EQ(json, dumpThroughDom<Writer<StringBuffer>>(lazy));
+  EXPECT_EQ(json, dumpThroughDom<Writer<StringBuffer>>(eager));
+  EXPECT_EQ(json::DumpPretty(eager), json::DumpPretty(lazy));
+  lazy.secret.Invalidate();
+  eager.secret.Invalidate();
+  EXPECT_EQ(json::Dump(eager), json::Dump(lazy));
+  EXPECT_EQ(std::string::npos, json::Dump(lazy).find("extra"));
+}
+
+TEST(JsonAnyTest, TestInterning) {
+  json::StringPool pool;
+  json::InternedString a("beijing", 7, pool);
+  json::InternedString b(std::string("beijing"), pool);
+  EXPECT_EQ(&a.Str(), &b.Str());
+  EXPECT_EQ(1u, pool.Size());
+  EXPECT_TRUE(a == json::InternedString("beijing"));
+  EXPECT_TRUE(a != json::InternedString("shanghai", 8, pool));
+  EXPECT_EQ("", json::InternedString().Str());
+  static const char* json =
+      "[{\"name\":\"the grand stadium\",\"capacity\":1},"
+      "{\"name\":\"the small club\",\"capacity\":2},"
+      "{\"name\":\"the grand stadium\",\"capacity\":3}]";
+  json::SaxReader reader(json, strlen(json));
+  std::vector<SharedVenue> venues = json::ParseArray<SharedVenue>(reader);
+  ASSERT_EQ(3u, venues.size());
+  EXPECT_EQ("the grand stadium", venues[0].name.Str());
+  EXPECT_EQ(&venues[0].name.Str(), &venues[2].name.Str());
+  EXPECT_EQ(json, json::Dump(venues));
+  rapidjson::Document doc;
+  doc.Parse(json);
+  std::vector<SharedVenue> bound = json::ParseArray<SharedVenue>(doc);
+  EXPECT_EQ(&venues[1].name.Str(), &bound[1].name.Str());
+  rapidjson::Document dumped;
+  json::Dump(dumped, dumped.GetAllocator(), bound);
+  EXPECT_EQ(bound[0].name.Str().data(), dumped[0]["name"].GetString());
+  json::InternedString city;
+  json::Parse(city, "\"beijing\"");
+  EXPECT_EQ("beijing", city.Str());
+  json::Status status =
+      json::TryParse(venues[0], "{\"name\":1,\"capacity\":1}");
+  EXPECT_EQ("/name", status.path);
+  EXPECT_EQ("Invalid 'name' in JSON", status.message);
+  // Readers and scopes keep values out of the global pool.
+  static const char* local =
+      "[{\"name\":\"a local hall\",\"capacity\":1},"
+      "{\"name\":\"a local bar\",\"capacity\":2}]";
+  size_t global = json::StringPool::Global().Size();
+  json::StringPool readerPool;
+  json::SaxReader pooled(local, strlen(local));
+  pooled.SetStringPool(&readerPool);
+  std::vector<SharedVenue> halls = json::ParseArray<SharedVenue>(pooled);
+  EXPECT_EQ(2u, readerPool.Size());
+  EXPECT_EQ(&readerPool.Intern("a local bar", 11), &halls[1].name.Str());
+  json::StringPool scopePool;
+  {
+    json::StringPoolScope scope(scopePool);
+    rapidjson::Document localDoc;
+    localDoc.Parse(local);
+    json::ParseArray<SharedVenue>(localDoc);
+    json::SaxReader unpooled(local, strlen(local));
+    json::ParseArray<SharedVenue>(unpooled);
+  }
+  EXPECT_EQ(2u, scopePool.Size());
+  EXPECT_EQ(global, json::StringPool::Global().Size());
+}
+
+TEST(JsonAnyTest, TestParseInto) {
+  static const char* longNames =
+      "{\"name\":\"tour\",\"venues\":[{\"name\":\"a venue with a long "
+      "name\",\"capacity\":1},{\"name\":\"b\",\"capacity\":2}],"
+      "\"year\":2020}";
+  static const char* shortNames =
+      "{\"name\":\"tour\",\"venues\":[{\"name\":\"a\",\"capacity\":3}],"
+      "\"year\":2021}";
+  size_t small = std::string().capacity();
+  // Plain Parse binds fresh elements.
+  Setlist parsed;
+  json::Parse(parsed, longNames);
+  json::Parse(parsed, shortNames);
+  EXPECT_EQ(small, parsed.venues[0].name.capacity());
+  // ParseInto binds over them, through SAX and DOM alike.
+  Setlist reused;
+  json::Parse(reused, longNames);
+  json::SaxReader shortReader(shortNames, strlen(shortNames));
+  json::ParseInto(reused, shortReader);
+  EXPECT_EQ(shortNames, json::Dump(reused));
+  EXPECT_LT(small, reused.venues[0].name.capacity());
+  rapidjson::Document longDoc;
+  longDoc.Parse(longNames);
+  json::ParseInto(reused, longDoc);
+  EXPECT_EQ(longNames, json::Dump(reused));
+  rapidjson::Document shortDoc;
+  shortDoc.Parse(shortNames);
+  json::ParseInto(reused, shortDoc);
+  EXPECT_LT(small, reused.venues[0].name.capacity());
+  json::Parse(reused, longNames);
+  json::Parse(reused, shortNames);
+  EXPECT_EQ(small, reused.venues[0].name.capacity());
+  // One reader, Reset for every document.
+  static const char* first =
+      "{\"name\":\"tour\",\"venues\":[{\"name\":\"a\",\"capacity\":1},"
+      "{\"name\":\"b\",\"capacity\":2}],\"year\":2020}";
+  static const char* second =
+      "{\"name\":\"tour\",\"venues\":[{\"name\":\"c\",\"capacity\":3}],"
+      "\"year\":2021}";
+  Setlist setlist;
+  json::SaxReader reader(first, strlen(first));
+  json::ParseInto(setlist, reader);
+  const Venue* venues = setlist.venues.data();
+  reader.Reset(second, strlen(second));
+  json::ParseInto(setlist, reader);
+  EXPECT_EQ(second, json::Dump(setlist));
+  EXPECT_EQ(venues, setlist.venues.data());
+  reader.Reset("{\"name\":1}", 10);
+  EXPECT_THROW(json::ParseInto(setlist, reader), std::invalid_argument);
+  reader.Reset(first, strlen(first));
+  json::ParseInto(setlist, reader);
+  EXPECT_EQ(first, json::Dump(setlist));
+  rapidjson::Document doc;
+  doc.Parse(second);
+  json::ParseInto(setlist.venues, doc["venues"]);
+  EXPECT_EQ(1u, setlist.venues.size());
+  EXPECT_EQ(venues, setlist.venues.data());
+  // Nested structs and hand-written parsers reuse their members too.
+  static const char* longFriends =
+      "{\"name\":\"p\",\"age\":1,\"address\":{\"country\":\"c\",\"city\":"
+      "\"c\",\"street\":\"s\",\"neighbors\":[]},\"friends\":[{\"relation\":"
+      "\"a friend with a long relation\",\"secret\":null},{\"relation\":"
+      "\"b\",\"secret\":null}],\"secret\":null}";
+  static const char* shortFriends =
+      "{\"name\":\"q\",\"age\":2,\"address\":{\"country\":\"c\",\"city\":"
+      "\"c\",\"street\":\"s\",\"neighbors\":[]},\"friends\":[{\"relation\":"
+      "\"c\",\"secret\":null}],\"secret\":null}";
+  Person person;
+  json::Parse(person, longFriends);
+  const Friend* friends = person.friends.data();
+  json::SaxReader personReader(shortFriends, strlen(shortFriends));
+  json::ParseInto(person, personReader);
+  EXPECT_EQ(shortFriends, json::Dump(person));
+  EXPECT_EQ(friends, person.friends.data());
+  EXPECT_LT(small, person.friends[0].relation.capacity());
+  Band band;
+  json::Parse(band, "{\"singers\":[{\"type\":\"a singer of a long type\","
+                    "\"age\":1}]}");
+  const Singer* singers = band.singers.data();
+  rapidjson::Document bandDoc;
+  bandDoc.Parse("{\"singers\":[{\"type\":\"b\",\"age\":2}]}");
+  json::ParseInto(band, bandDoc);
+  EXPECT_EQ(singers, band.singers.data());
+  EXPECT_EQ("b", band.singers[0].type);
+  // A parse started inside ParseInto binds fresh elements.
+  {
+    json::detail::InPlaceScope scope(true);
+    json::Parse(parsed, longNames);
+    json::Parse(parsed, shortNames);
+    EXPECT_EQ(small, parsed.venues[0].name.capacity());
+  }
+}
+
 TEST(JsonAnyTest, TestAll) {
   std::string json;
   // Singer
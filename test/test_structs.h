@@ -18,6 +18,16 @@ struct Singer {
     v.AddMember("age", age, alloc);
   }
 
+  template <typename Writer>
+  void Write(Writer& w) {
+    w.StartObject();
+    w.Key("type");
+    w.String(type);
+    w.Key("age");
+    w.Int(age);
+    w.EndObject();
+  }
+
   void Parse(const rapidjson::Value& v) {
     using rapidjson::Value;
     if (!v.HasMember("type")) {
@@ -37,6 +47,34 @@ struct Singer {
     }
     this->age = ageValue.GetInt();
   }
+
+  void Parse(json::SaxReader& r) {
+    bool hasType = false;
+    bool hasAge = false;
+    r.StartObject();
+    while (r.NextMember()) {
+      const std::string& key = r.Key();
+      if (key == "type") {
+        if (!r.Read(this->type)) {
+          throw std::invalid_argument("Invalid 'type' in JSON");
+        }
+        hasType = true;
+      } else if (key == "age") {
+        if (!r.Read(this->age)) {
+          throw std::invalid_argument("Invalid 'age' in JSON");
+        }
+        hasAge = true;
+      } else {
+        r.Skip();
+      }
+    }
+    if (!hasType && !r.IsProjected()) {
+      throw std::invalid_argument("No 'type' in JSON");
+    }
+    if (!hasAge && !r.IsProjected()) {
+      throw std::invalid_argument("No 'age' in JSON");
+    }
+  }
 };
 
 struct Band {
@@ -51,6 +89,14 @@ struct Band {
     v.AddMember("singers", singersValue, alloc);
   }
 
+  template <typename Writer>
+  void Write(Writer& w) {
+    w.StartObject();
+    w.Key("singers");
+    json::Write(w, singers);
+    w.EndObject();
+  }
+
   void Parse(const rapidjson::Value& v) {
     using rapidjson::Value;
     if (!v.HasMember("singers")) {
@@ -60,7 +106,26 @@ struct Band {
     if (!singersValue.IsArray()) {
       throw std::invalid_argument("Invalid 'singers' in JSON");
     }
-    this->singers = json::ParseArray<Singer>(singersValue);
+    json::ParseArrayInto(this->singers, singersValue);
+  }
+
+  void Parse(json::SaxReader& r) {
+    bool hasSingers = false;
+    r.StartObject();
+    while (r.NextMember()) {
+      if (r.Key() == "singers") {
+        if (!r.IsArray()) {
+          throw std::invalid_argument("Invalid 'singers' in JSON");
+        }
+        json::ParseArrayInto(this->singers, r);
+        hasSingers = true;
+      } else {
+        r.Skip();
+      }
+    }
+    if (!hasSingers && !r.IsProjected()) {
+      throw std::invalid_argument("No 'singers' in JSON");
+    }
   }
 };
 
@@ -70,85 +135,14 @@ struct Address {
   std::string street;
   std::vector<Person> neighbors;
 
-  template <typename AllocatorType>
-  void Dump(rapidjson::Value& v, AllocatorType& alloc) {
-    using rapidjson::Value;
-    v.SetObject();
-    v.AddMember("country", country, alloc);
-    v.AddMember("city", city, alloc);
-    v.AddMember("street", street, alloc);
-    Value neighborsValue;
-    json::Dump(neighborsValue, alloc, neighbors);
-    v.AddMember("neighbors", neighborsValue, alloc);
-  }
-
-  void Parse(const rapidjson::Value& v) {
-    using rapidjson::Value;
-    if (!v.HasMember("country")) {
-      throw std::invalid_argument("No 'country' in JSON");
-    }
-    const Value& countryValue = v["country"];
-    if (!countryValue.IsString()) {
-      throw std::invalid_argument("Invalid 'country' in JSON");
-    }
-    this->country = countryValue.GetString();
-    if (!v.HasMember("city")) {
-      throw std::invalid_argument("No 'city' in JSON");
-    }
-    const Value& cityValue = v["city"];
-    if (!cityValue.IsString()) {
-      throw std::invalid_argument("Invalid 'city' in JSON");
-    }
-    this->city = cityValue.GetString();
-    if (!v.HasMember("street")) {
-      throw std::invalid_argument("No 'street' in JSON");
-    }
-    const Value& streetValue = v["street"];
-    if (!streetValue.IsString()) {
-      throw std::invalid_argument("Invalid 'street' in JSON");
-    }
-    this->street = streetValue.GetString();
-    if (!v.HasMember("neighbors")) {
-      throw std::invalid_argument("No 'neighbors' in JSON");
-    }
-    const Value& neighborsValue = v["neighbors"];
-    if (!neighborsValue.IsArray()) {
-      throw std::invalid_argument("Invalid 'neighbors' in JSON");
-    }
-    this->neighbors = json::ParseArray<Person>(neighborsValue);
-  }
+  JSON_ANY_FIELDS(Address, country, city, street, neighbors)
 };
 
 struct Friend {
   std::string relation;
   json::Any secret;
 
-  template <typename AllocatorType>
-  void Dump(rapidjson::Value& v, AllocatorType& alloc) {
-    using rapidjson::Value;
-    v.SetObject();
-    v.AddMember("relation", relation, alloc);
-    Value secretValue;
-    secret.Dump(secretValue, alloc);
-    v.AddMember("secret", secretValue, alloc);
-  }
-
-  void Parse(const rapidjson::Value& v) {
-    using rapidjson::Value;
-    if (!v.HasMember("relation")) {
-      throw std::invalid_argument("No 'relation' in JSON");
-    }
-    const Value& relationValue = v["relation"];
-    if (!relationValue.IsString()) {
-      throw std::invalid_argument("Invalid 'relation' in JSON");
-    }
-    this->relation = relationValue.GetString();
-    if (!v.HasMember("secret")) {
-      throw std::invalid_argument("No 'secret' in JSON");
-    }
-    const Value& secretValue = v["secret"];
-    this->secret.Parse(secretValue);
-  }
+  JSON_ANY_FIELDS(Friend, relation, secret)
 };
 
 struct Person {
@@ -158,63 +152,7 @@ struct Person {
   std::vector<Friend> friends;
   json::Any secret;
 
-  template <typename AllocatorType>
-  void Dump(rapidjson::Value& v, AllocatorType& alloc) {
-    using rapidjson::Value;
-    v.SetObject();
-    v.AddMember("name", name, alloc);
-    v.AddMember("age", age, alloc);
-    Value addressValue;
-    address.Dump(addressValue, alloc);
-    v.AddMember("address", addressValue, alloc);
-    Value friendsValue;
-    json::Dump(friendsValue, alloc, friends);
-    v.AddMember("friends", friendsValue, alloc);
-    Value secretValue;
-    secret.Dump(secretValue, alloc);
-    v.AddMember("secret", secretValue, alloc);
-  }
-
-  void Parse(const rapidjson::Value& v) {
-    using rapidjson::Value;
-    if (!v.HasMember("name")) {
-      throw std::invalid_argument("No 'name' in JSON");
-    }
-    const Value& nameValue = v["name"];
-    if (!nameValue.IsString()) {
-      throw std::invalid_argument("Invalid 'name' in JSON");
-    }
-    this->name = nameValue.GetString();
-    if (!v.HasMember("age")) {
-      throw std::invalid_argument("No 'age' in JSON");
-    }
-    const Value& ageValue = v["age"];
-    if (!ageValue.IsInt()) {
-      throw std::invalid_argument("Invalid 'age' in JSON");
-    }
-    this->age = ageValue.GetInt();
-    if (!v.HasMember("address")) {
-      throw std::invalid_argument("No 'address' in JSON");
-    }
-    const Value& addressValue = v["address"];
-    if (!addressValue.IsObject()) {
-      throw std::invalid_argument("Invalid 'address' in JSON");
-    }
-    this->address.Parse(addressValue);
-    if (!v.HasMember("friends")) {
-      throw std::invalid_argument("No 'friends' in JSON");
-    }
-    const Value& friendsValue = v["friends"];
-    if (!friendsValue.IsArray()) {
-      throw std::invalid_argument("Invalid 'friends' in JSON");
-    }
-    this->friends = json::ParseArray<Friend>(friendsValue);
-    if (!v.HasMember("secret")) {
-      throw std::invalid_argument("No 'secret' in JSON");
-    }
-    const Value& secretValue = v["secret"];
-    this->secret.Parse(secretValue);
-  }
+  JSON_ANY_FIELDS(Person, name, age, address, friends, secret)
 };
 
 struct NonCopyable {
@@ -242,3 +180,49 @@ struct NonCopyable {
     this->name = nameValue.GetString();
   }
 };
+
+struct Venue {
+  std::string name;
+  int capacity = 0;
+
+  JSON_ANY_FIELDS(Venue, name, capacity)
+};
+
+struct Concert {
+  std::string title;
+  int year = 0;
+  Venue venue;
+  Band headliner;
+  std::vector<Singer> guests;
+  json::Any sponsor;
+
+  JSON_ANY_FIELDS(Concert, title, year, venue, headliner, guests, sponsor)
+};
+
+struct Setlist {
+  std::string name;
+  std::vector<Venue> venues;
+  int year = 0;
+
+  JSON_ANY_FIELDS(Setlist, name, venues, year)
+};
+
+// Same JSON as Venue, with the name bound through the global StringPool.
+struct SharedVenue {
+  json::InternedString name;
+  int capacity = 0;
+
+  JSON_ANY_FIELDS(SharedVenue, name, capacity)
+};
+
+struct Telemetry {
+  int64_t id = 0;
+  uint64_t count = 0;
+  double ratio = 0;
+  bool active = false;
+  std::vector<double> samples;
+  std::vector<int64_t> offsets;
+  std::vector<bool> flags;
+
+  JSON_ANY_FIELDS(Telemetry, id, count, ratio, active, samples, offsets, flags)
+};
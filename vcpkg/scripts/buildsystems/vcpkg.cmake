@@ -0,0 +1 @@
+list(APPEND CMAKE_PREFIX_PATH "/tmp/rjmock")